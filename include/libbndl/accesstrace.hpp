@@ -0,0 +1,29 @@
+#pragma once
+#include "libbndl_export.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace libbndl
+{
+	// Records the order in which resources are first read, so a bundle can be saved with
+	// resources that are used together laid out next to each other.
+	class AccessTrace
+	{
+	public:
+		LIBBNDL_EXPORT void Record(uint32_t resourceID);
+		LIBBNDL_EXPORT void Clear();
+		LIBBNDL_EXPORT std::vector<uint32_t> GetOrder() const;
+
+		// One hexadecimal resource ID per line.
+		LIBBNDL_EXPORT bool Load(const std::string &name);
+		LIBBNDL_EXPORT bool Save(const std::string &name) const;
+
+	private:
+		mutable std::mutex m_mutex;
+		std::vector<uint32_t> m_order;
+		std::unordered_set<uint32_t> m_seen;
+	};
+}
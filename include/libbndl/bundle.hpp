@@ -1,6 +1,11 @@
 #pragma once
 #include "libbndl_export.h"
 #include <string>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iosfwd>
+#include <iterator>
 #include <map>
 #include <vector>
 #include <mutex>
@@ -15,6 +20,15 @@ namespace binaryio
 
 namespace libbndl
 {
+	class AccessTrace;
+	class DecompressionCache;
+	class SharedIndex;
+
+	namespace detail
+	{
+		class InflateIndex;
+	}
+
 	class Bundle
 	{
 	public:
@@ -164,7 +178,8 @@ namespace libbndl
 			uint32_t uncompressedSize;
 			uint32_t uncompressedAlignment; // default depending on file type
 			uint32_t compressedSize;
-			std::unique_ptr<std::vector<uint8_t>> data;
+			// Stored bytes are never modified in place, so copies of a bundle share them until a resource is replaced.
+			std::shared_ptr<const std::vector<uint8_t>> data;
 		};
 
 		struct EntryDebugInfo
@@ -202,12 +217,262 @@ namespace libbndl
 			std::vector<Dependency> dependencies;
 		};
 
+		// Turns one build of a bundle into another. Added and changed resources carry the stored
+		// (possibly compressed) blocks of the newer bundle, so it only applies to bundles of the same
+		// format, platform and compression.
+		struct Patch
+		{
+			MagicVersion magicVersion;
+			Platform platform;
+			bool compressed;
+
+			std::vector<uint32_t> added;
+			std::vector<uint32_t> removed;
+			std::vector<uint32_t> changed;
+
+			std::map<uint32_t, Entry> entries;
+			std::map<uint32_t, std::vector<Dependency>> dependencies; // bndl only
+			std::map<uint32_t, EntryDebugInfo> debugInfo;
+		};
+
+		// A resource compressed for one bundle format, ready to be swapped in without further work.
+		struct PreparedResource
+		{
+			uint32_t resourceID;
+			EntryInfo info; // resourceType is left as is
+			EntryFileBlockData fileBlockData[3];
+			std::vector<Dependency> dependencies; // bndl only, bnd2 keeps them in block 0
+			MagicVersion magicVersion;
+			Platform platform;
+			bool compressed;
+		};
+
+		struct VerifyIssue
+		{
+			uint32_t resourceID; // 0 for problems with the bundle itself
+			std::string message;
+		};
+
+		struct DataView
+		{
+			const uint8_t *data = nullptr;
+			size_t size = 0;
+		};
+
+		struct ProbeInfo
+		{
+			MagicVersion magicVersion;
+			uint32_t revisionNumber;
+			Platform platform;
+			Flags flags;
+			uint32_t numEntries; // bndl counts its resource string table as an entry
+			uint32_t blockSizes[3]; // stored size of each data block, as laid out in the file
+		};
+
+		struct ResourceSummary
+		{
+			uint32_t resourceID;
+			ResourceType resourceType;
+			uint32_t uncompressedSizes[3];
+			uint32_t compressedSizes[3]; // 0 unless the bundle is compressed
+		};
+
+		struct BundleSummary
+		{
+			ProbeInfo header;
+			std::vector<ResourceSummary> resources;
+		};
+
+		struct ResourceInfo : ResourceSummary
+		{
+			const EntryDebugInfo *debugInfo; // nullptr if the resource has none
+		};
+
+		// Sorted resource IDs, in place in the bundle's index. Valid until resources are next added or removed.
+		struct ResourceIDView
+		{
+			const uint32_t *first = nullptr;
+			const uint32_t *last = nullptr;
+
+			const uint32_t *begin() const
+			{
+				return first;
+			}
+
+			const uint32_t *end() const
+			{
+				return last;
+			}
+
+			size_t size() const
+			{
+				return last - first;
+			}
+
+			bool empty() const
+			{
+				return first == last;
+			}
+		};
+
+		// Walks the entries and debug info side by side, both being sorted by ID, so no lookups are made.
+		class ResourceIterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = ResourceInfo;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const ResourceInfo *;
+			using reference = const ResourceInfo &;
+
+			ResourceIterator(std::map<uint32_t, Entry>::const_iterator entry, std::map<uint32_t, Entry>::const_iterator entryEnd,
+				std::map<uint32_t, EntryDebugInfo>::const_iterator debugInfo, std::map<uint32_t, EntryDebugInfo>::const_iterator debugInfoEnd)
+				: m_entry(entry), m_entryEnd(entryEnd), m_debugInfo(debugInfo), m_debugInfoEnd(debugInfoEnd)
+			{
+				Fill();
+			}
+
+			reference operator*() const
+			{
+				return m_info;
+			}
+
+			pointer operator->() const
+			{
+				return &m_info;
+			}
+
+			ResourceIterator &operator++()
+			{
+				++m_entry;
+				Fill();
+				return *this;
+			}
+
+			ResourceIterator operator++(int)
+			{
+				auto previous = *this;
+				++*this;
+				return previous;
+			}
+
+			bool operator==(const ResourceIterator &other) const
+			{
+				return m_entry == other.m_entry;
+			}
+
+			bool operator!=(const ResourceIterator &other) const
+			{
+				return m_entry != other.m_entry;
+			}
+
+		private:
+			void Fill()
+			{
+				if (m_entry == m_entryEnd)
+					return;
+
+				const auto &e = m_entry->second;
+				m_info.resourceID = m_entry->first;
+				m_info.resourceType = e.info.resourceType;
+				for (auto i = 0; i < 3; i++)
+				{
+					m_info.uncompressedSizes[i] = e.fileBlockData[i].uncompressedSize;
+					m_info.compressedSizes[i] = e.fileBlockData[i].compressedSize;
+				}
+
+				while (m_debugInfo != m_debugInfoEnd && m_debugInfo->first < m_info.resourceID)
+					++m_debugInfo;
+				m_info.debugInfo = (m_debugInfo != m_debugInfoEnd && m_debugInfo->first == m_info.resourceID) ? &m_debugInfo->second : nullptr;
+			}
+
+			std::map<uint32_t, Entry>::const_iterator m_entry;
+			std::map<uint32_t, Entry>::const_iterator m_entryEnd;
+			std::map<uint32_t, EntryDebugInfo>::const_iterator m_debugInfo;
+			std::map<uint32_t, EntryDebugInfo>::const_iterator m_debugInfoEnd;
+			ResourceInfo m_info = {};
+		};
+
+		struct ResourceRange
+		{
+			ResourceIterator first;
+			ResourceIterator last;
+
+			ResourceIterator begin() const
+			{
+				return first;
+			}
+
+			ResourceIterator end() const
+			{
+				return last;
+			}
+		};
+
+		// Order of resource data within each data block. The ID table itself always stays sorted by ID.
+		enum SaveOrder
+		{
+			OrderByID,
+			OrderByType,
+			OrderByDependencies, // each resource directly after the resources it imports
+			OrderByAccessTrace // resources in the order they were first read, the rest by ID
+		};
+
+		struct SaveOptions
+		{
+			bool deduplicateBlocks = false; // Store byte-identical blocks once and point every entry using them at that copy.
+			SaveOrder order = OrderByID;
+			const AccessTrace *accessTrace = nullptr; // for OrderByAccessTrace, defaults to the bundle's own trace
+			// Uncompressed bundles only: start every resource block on an OS page boundary (or its own
+			// alignment, if larger), so blocks can be mapped or read with O_DIRECT in place.
+			bool pageAlignBlocks = false;
+		};
+
+		struct SaveStatistics
+		{
+			uint32_t deduplicatedBlocks = 0;
+			uint64_t bytesSaved = 0;
+		};
+
 
 		LIBBNDL_EXPORT Bundle() = default;
 		LIBBNDL_EXPORT Bundle(MagicVersion magicVersion, uint32_t revisionNumber, Platform platform, Flags flags); // For creating new bundles
 
+		// Copies the entry tables only; stored blocks are shared until either bundle replaces them.
+		// The access trace, if set, is shared as well.
+		LIBBNDL_EXPORT Bundle Snapshot() const;
+
 		LIBBNDL_EXPORT bool Load(const std::string &name);
+		// The buffer is read in place rather than copied as a whole, but each block is copied out of it,
+		// so the buffer is not referenced after loading.
+		LIBBNDL_EXPORT bool Load(const std::shared_ptr<std::vector<uint8_t>> &buffer);
+		// The memory is only read during the call and may be released as soon as it returns.
+		LIBBNDL_EXPORT bool Load(const uint8_t *data, size_t size);
+		// Reads from the current position to the end of the stream.
+		LIBBNDL_EXPORT bool Load(std::istream &stream);
+		// Called from the loading thread as entries are read; returning false cancels the load, which then fails.
+		using LoadProgress = std::function<bool(size_t loadedEntries, size_t totalEntries)>;
+		LIBBNDL_EXPORT bool Load(const std::string &name, const LoadProgress &progress);
 		LIBBNDL_EXPORT bool Save(const std::string &name);
+		LIBBNDL_EXPORT bool Save(const std::string &name, const SaveOptions &options, SaveStatistics *statistics = nullptr);
+		LIBBNDL_EXPORT bool Save(std::ostream &stream);
+		LIBBNDL_EXPORT bool Save(std::ostream &stream, const SaveOptions &options, SaveStatistics *statistics = nullptr);
+		// Replaces the contents of the buffer with the bundle file.
+		LIBBNDL_EXPORT bool Save(std::vector<uint8_t> &buffer);
+		LIBBNDL_EXPORT bool Save(std::vector<uint8_t> &buffer, const SaveOptions &options, SaveStatistics *statistics = nullptr);
+
+		// Checks header offsets, block bounds, compressed streams, imports and import hashes of a bundle
+		// file without keeping any decompressed data. The file is memory mapped, not read, and entries are
+		// checked on all cores.
+		LIBBNDL_EXPORT static std::vector<VerifyIssue> Verify(const std::string &name);
+
+		// Reads only the file header. Empty if the file is not a supported bundle.
+		LIBBNDL_EXPORT static std::optional<ProbeInfo> Probe(const std::string &name);
+		LIBBNDL_EXPORT static std::optional<ProbeInfo> Probe(const uint8_t *data, size_t size);
+		// Reads the header and entry tables only; no resource data is read or decompressed.
+		LIBBNDL_EXPORT static std::optional<BundleSummary> Summarize(const std::string &name);
+		// Reads the header and the resource string table only. Empty map if the bundle has no table.
+		LIBBNDL_EXPORT static std::optional<std::map<uint32_t, EntryDebugInfo>> ReadDebugInfo(const std::string &name);
 
 		LIBBNDL_EXPORT MagicVersion GetMagicVersion() const
 		{
@@ -233,10 +498,24 @@ namespace libbndl
 		LIBBNDL_EXPORT std::optional<EntryDebugInfo> GetDebugInfo(uint32_t resourceID) const;
 		LIBBNDL_EXPORT std::optional<ResourceType> GetResourceType(const std::string &resourceName) const;
 		LIBBNDL_EXPORT std::optional<ResourceType> GetResourceType(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::optional<EntryInfo> GetEntryInfo(uint32_t resourceID) const;
 		LIBBNDL_EXPORT std::optional<EntryData> GetData(const std::string &resourceName) const;
 		LIBBNDL_EXPORT std::optional<EntryData> GetData(uint32_t resourceID) const;
+		// Null if the block is empty or its stored data does not inflate.
 		LIBBNDL_EXPORT std::unique_ptr<std::vector<uint8_t>> GetBinary(const std::string &resourceName, uint32_t fileBlock) const;
 		LIBBNDL_EXPORT std::unique_ptr<std::vector<uint8_t>> GetBinary(uint32_t resourceID, uint32_t fileBlock) const;
+		// The first `size` bytes of a block, or the whole block if it is smaller. Compressed blocks are only inflated
+		// as far as needed, into `scratch`; uncompressed blocks are returned in place. The view is valid until the
+		// resource is replaced or removed, or `scratch` is reused.
+		LIBBNDL_EXPORT std::optional<DataView> ReadPrefix(uint32_t resourceID, uint32_t fileBlock, size_t size, std::vector<uint8_t> &scratch) const;
+		LIBBNDL_EXPORT std::unique_ptr<std::vector<uint8_t>> ReadPrefix(uint32_t resourceID, uint32_t fileBlock, size_t size) const;
+		// `size` bytes starting at `offset` into a block. Compressed blocks with a seek index are inflated from the
+		// nearest checkpoint before `offset`, all others from the start of the block.
+		LIBBNDL_EXPORT std::unique_ptr<std::vector<uint8_t>> ReadRange(uint32_t resourceID, uint32_t fileBlock, size_t offset, size_t size) const;
+		LIBBNDL_EXPORT std::optional<std::vector<Dependency>> GetDependencies(const std::string &resourceName) const;
+		LIBBNDL_EXPORT std::optional<std::vector<Dependency>> GetDependencies(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::optional<uint32_t> GetUncompressedSize(const std::string &resourceName, uint32_t fileBlock) const;
+		LIBBNDL_EXPORT std::optional<uint32_t> GetUncompressedSize(uint32_t resourceID, uint32_t fileBlock) const;
 
 		LIBBNDL_EXPORT bool AddResource(const std::string &resourceName, const EntryData &data, ResourceType resourceType);
 		LIBBNDL_EXPORT bool AddResource(uint32_t resourceID, const EntryData &data, ResourceType resourceType);
@@ -245,28 +524,127 @@ namespace libbndl
 
 		LIBBNDL_EXPORT bool ReplaceResource(const std::string &resourceName, const EntryData &data);
 		LIBBNDL_EXPORT bool ReplaceResource(uint32_t resourceID, const EntryData &data);
+		// Does all the work of ReplaceResource without changing the bundle, so resources can be compressed on
+		// other threads while the bundle is in use. Only the bundle's format is read.
+		LIBBNDL_EXPORT std::optional<PreparedResource> PrepareResource(uint32_t resourceID, const EntryData &data) const;
+		// Swaps in every prepared resource, or none if any of them is missing or was prepared for another format.
+		LIBBNDL_EXPORT bool ReplaceResources(std::vector<PreparedResource> resources);
+
+		// Stored blocks are shared with source when both bundles have the same format, platform and compression,
+		// otherwise the resource is decompressed and added again. Copying from this bundle itself fails.
+		LIBBNDL_EXPORT bool CopyResourceFrom(const Bundle &source, const std::string &resourceName);
+		LIBBNDL_EXPORT bool CopyResourceFrom(const Bundle &source, uint32_t resourceID);
+		// Copies every resource of source, skipping (or replacing) the ones this bundle already has.
+		// Merging a bundle into itself changes nothing.
+		LIBBNDL_EXPORT bool Merge(const Bundle &source, bool replaceExisting = false);
+		// Moves the given resources out of this bundle into a new one with the same header.
+		LIBBNDL_EXPORT Bundle Split(const std::vector<uint32_t> &resourceIDs);
+
+		// Switches the bundle to another platform's byte order, including the import tables in block 0.
+		// Resource data itself is platform specific and is left as is.
+		LIBBNDL_EXPORT bool ConvertPlatform(Platform platform);
+
+		// Entry info, block sizes and stored bytes are compared first; blocks are only inflated when stored bytes differ.
+		LIBBNDL_EXPORT Patch Diff(const Bundle &newer) const;
+		LIBBNDL_EXPORT bool ApplyPatch(const Patch &patch);
+		// Patch files hold the removed IDs and the entries and stored blocks of added and changed resources,
+		// so a patch of a compressed bundle is compressed as well.
+		LIBBNDL_EXPORT static bool SavePatch(const Patch &patch, const std::string &name);
+		LIBBNDL_EXPORT static std::optional<Patch> LoadPatch(const std::string &name);
+
+		using SeekIndex = detail::InflateIndex;
+		// Indexes every compressed block of at least `minimumSize` bytes with a checkpoint about every `spacing`
+		// bytes, at the cost of 32K per checkpoint. Indexes of a resource are dropped when it is changed.
+		LIBBNDL_EXPORT bool BuildSeekIndex(uint32_t spacing = 1 << 20, uint32_t minimumSize = 4 << 20);
+		// Indexes a single block without adding the index, so it can run on another thread while the bundle is read.
+		// Empty if the block is not compressed or once `cancelled` is set. AddSeekIndex fails if the block changed since.
+		LIBBNDL_EXPORT std::shared_ptr<const SeekIndex> BuildBlockSeekIndex(uint32_t resourceID, uint32_t fileBlock, const std::atomic<bool> *cancelled = nullptr, uint32_t spacing = 1 << 20) const;
+		LIBBNDL_EXPORT bool AddSeekIndex(uint32_t resourceID, uint32_t fileBlock, std::shared_ptr<const SeekIndex> index);
+		LIBBNDL_EXPORT bool HasSeekIndex(uint32_t resourceID, uint32_t fileBlock) const;
+		// The seek index can be kept next to the bundle; entries for blocks that changed since are skipped on load.
+		LIBBNDL_EXPORT bool LoadSeekIndex(const std::string &name);
+		LIBBNDL_EXPORT bool SaveSeekIndex(const std::string &name) const;
+
+		// Every GetBinary/GetData call on this bundle is recorded into the trace, if set.
+		LIBBNDL_EXPORT void SetAccessTrace(std::shared_ptr<AccessTrace> accessTrace);
+		// Whole compressed blocks read by GetBinary/GetData are looked up in and added to the cache, if set.
+		LIBBNDL_EXPORT void SetDecompressionCache(std::shared_ptr<DecompressionCache> decompressionCache);
 
 		LIBBNDL_EXPORT std::vector<uint32_t> ListResourceIDs() const;
 		LIBBNDL_EXPORT std::map<ResourceType, std::vector<uint32_t>> ListResourceIDsByType() const;
+		// Sorted; only the types are copied, so pair it with GetResourceIDs to walk the resources by type.
+		LIBBNDL_EXPORT std::vector<ResourceType> ListResourceTypes() const;
+		// Allocation-free alternatives to the above. Both are valid until resources are next added or removed.
+		LIBBNDL_EXPORT ResourceRange GetResources() const;
+		LIBBNDL_EXPORT ResourceIDView GetResourceIDs(ResourceType resourceType) const;
 
 	private:
+		friend class SharedIndex;
+
+		// File offset of each stored block, by resource ID.
+		using BlockOffsets = std::map<uint32_t, std::array<uint64_t, 3>>;
+
+		struct BND2Header
+		{
+			uint32_t revisionNumber;
+			Platform platform;
+			uint32_t rstOffset;
+			uint32_t numEntries;
+			uint32_t idBlockOffset;
+			uint32_t fileBlockOffsets[3];
+			Flags flags;
+		};
+
 		std::map<uint32_t, Entry>	m_entries;
 		std::map<uint32_t, EntryDebugInfo> m_debugInfoEntries;
-		std::map<uint32_t, std::vector<Dependency>> m_dependencies; // not used in bnd2 due to lazy reading.
+		std::map<uint32_t, std::vector<Dependency>> m_dependencies; // bndl only, bnd2 stores them at the end of block 0.
+		std::map<ResourceType, std::vector<uint32_t>> m_resourceIDsByType; // sorted, kept in step with m_entries
 
 		MagicVersion				m_magicVersion;
 		uint32_t					m_revisionNumber;
 		Platform					m_platform;
 		Flags						m_flags;
+		std::shared_ptr<AccessTrace> m_accessTrace;
+		std::shared_ptr<DecompressionCache> m_decompressionCache;
+		std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<const detail::InflateIndex>> m_seekIndex; // (resource ID, block)
 
-		bool LoadBND2(binaryio::BinaryReader &reader);
-		bool LoadBNDL(binaryio::BinaryReader &reader);
-		bool SaveBND2(binaryio::BinaryWriter &writer);
-		bool SaveBNDL(binaryio::BinaryWriter &writer);
+		static std::shared_ptr<std::vector<uint8_t>> ReadFile(const std::string &name);
+		static std::shared_ptr<std::vector<uint8_t>> ReadStream(std::istream &stream);
+		bool Write(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics *statistics);
+		static bool ReadBND2Header(binaryio::BinaryReader &reader, BND2Header &header);
+		// The tables are the file up to its first data block.
+		static void VerifyBND2(const std::shared_ptr<std::vector<uint8_t>> &tables, uint64_t fileSize, std::vector<VerifyIssue> &issues);
+		void VerifyEntries(const uint8_t *file, uint64_t fileSize, const BlockOffsets &blockOffsets, std::vector<VerifyIssue> &issues) const;
+		// Without readData only the tables are read, and entries are left without block data.
+		bool LoadBuffer(const std::shared_ptr<std::vector<uint8_t>> &buffer, BlockOffsets *blockOffsets = nullptr, const LoadProgress *progress = nullptr, bool readData = true);
+		bool LoadBND2(binaryio::BinaryReader &reader, BlockOffsets *blockOffsets, const LoadProgress *progress, bool readData);
+		bool LoadBNDL(binaryio::BinaryReader &reader, BlockOffsets *blockOffsets, const LoadProgress *progress, bool readData);
+		bool SaveBND2(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics &statistics);
+		bool SaveBNDL(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics &statistics);
 		int8_t MapBNDLBlockToBND2(uint8_t block) const;
-		uint32_t HashResourceName(std::string resourceName) const;
+		static int8_t MapBNDLBlockToBND2(Platform platform, uint8_t block);
+		static Platform ReadBNDLPlatform(const binaryio::BinaryReader &reader);
+		static std::optional<ProbeInfo> ProbeBuffer(const std::shared_ptr<std::vector<uint8_t>> &buffer, uint64_t fileSize);
+		static std::shared_ptr<std::vector<uint8_t>> ReadFileRange(std::istream &stream, uint64_t offset, uint64_t size);
+		static std::string ReadBNDLResourceStringTable(std::shared_ptr<std::vector<uint8_t>> rstFile);
+		static void ParseResourceStringTable(const std::string &rstXML, std::map<uint32_t, EntryDebugInfo> &debugInfoEntries);
+		std::vector<uint32_t> GetLayoutOrder(const SaveOptions &options) const;
+		// GetBinary without recording into the access trace, for internal reads.
+		std::unique_ptr<std::vector<uint8_t>> ReadBlock(uint32_t resourceID, uint32_t fileBlock) const;
+		std::unique_ptr<std::vector<uint8_t>> ReadBlockRange(uint32_t resourceID, uint32_t fileBlock, size_t offset, size_t size) const;
+		void DropSeekIndex(uint32_t resourceID);
+		void RebuildTypeIndex();
+		// Call before the entry is erased.
+		void UnindexResource(uint32_t resourceID);
+		void IndexResource(uint32_t resourceID);
+		uint32_t HashResourceName(const std::string &resourceName) const;
+		bool IsResourceEqual(uint32_t resourceID, const Bundle &other) const;
+		bool HasSameStorage(const Bundle &other) const;
+		static std::vector<Dependency> ReadDependencies(const EntryInfo &info, const std::vector<uint8_t> &block, bool bigEndian);
+		static std::vector<Dependency> ReadDependencyTable(const std::shared_ptr<std::vector<uint8_t>> &table, size_t count, bool bigEndian);
 
 		static Dependency ReadDependency(binaryio::BinaryReader &reader);
 		static void WriteDependency(binaryio::BinaryWriter &writer, const Dependency &dependency);
+		static uint32_t HashDependencies(const std::vector<Dependency> &dependencies);
 	};
 }
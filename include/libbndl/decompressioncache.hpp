@@ -0,0 +1,39 @@
+#pragma once
+#include "libbndl_export.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace libbndl
+{
+	// Keeps inflated blocks on disk, so that processes reading the same compressed bundles do not each
+	// inflate them again. Blocks are keyed by a hash of their stored bytes, which stays valid across
+	// rebuilt bundles and in-memory edits. Several processes may share one directory.
+	class DecompressionCache
+	{
+	public:
+		// Blocks inflating to less than `minimumBlockSize` bytes are not worth a file and are never cached.
+		// Once the directory grows past `maximumSize`, the least recently used blocks are removed.
+		LIBBNDL_EXPORT DecompressionCache(const std::string &directory, uint64_t maximumSize, uint32_t minimumBlockSize = 0x10000);
+
+		// Same contract as zlib's uncompress: fails unless exactly `outSize` bytes were produced.
+		LIBBNDL_EXPORT bool Inflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize);
+
+		LIBBNDL_EXPORT uint64_t GetSize() const;
+		LIBBNDL_EXPORT void Clear();
+
+	private:
+		std::string GetPath(const uint8_t *in, size_t inSize, size_t outSize) const;
+		void Store(const std::string &path, const uint8_t *data, size_t size);
+		// Rescans the directory and removes the least recently used blocks if it is over the maximum size,
+		// along with temporary files that stores never finished. Callers hold m_mutex.
+		void Trim();
+
+		std::string m_directory;
+		uint64_t m_maximumSize;
+		uint32_t m_minimumBlockSize;
+
+		mutable std::mutex m_mutex;
+		uint64_t m_size = 0; // as of the last scan, plus what this process stored since
+	};
+}
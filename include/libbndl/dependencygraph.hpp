@@ -0,0 +1,59 @@
+#pragma once
+#include "libbndl_export.h"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace libbndl
+{
+	class Bundle;
+
+	// Forward ("imports") and reverse ("imported by") resource edges across one or more bundles.
+	// The index is built on first query; added bundles must stay alive and unmodified until then.
+	class DependencyGraph
+	{
+	public:
+		LIBBNDL_EXPORT DependencyGraph() = default;
+		LIBBNDL_EXPORT explicit DependencyGraph(const Bundle &bundle);
+		LIBBNDL_EXPORT explicit DependencyGraph(const std::vector<const Bundle *> &bundles);
+
+		LIBBNDL_EXPORT void AddBundle(const Bundle &bundle);
+
+		// Whether the resource is stored in one of the bundles, as opposed to only being imported.
+		LIBBNDL_EXPORT bool Contains(uint32_t resourceID) const;
+		LIBBNDL_EXPORT const Bundle *FindBundle(uint32_t resourceID) const;
+
+		LIBBNDL_EXPORT const std::vector<uint32_t> &GetDependencies(uint32_t resourceID) const;
+		LIBBNDL_EXPORT const std::vector<uint32_t> &GetDependents(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::vector<uint32_t> GetTransitiveDependencies(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::vector<uint32_t> GetTransitiveDependents(uint32_t resourceID) const;
+
+		// Stored resources ordered so that every resource comes after the resources it imports.
+		// Empty if the graph contains a cycle.
+		LIBBNDL_EXPORT std::optional<std::vector<uint32_t>> GetLoadOrder() const;
+		// Dependencies of the resource (transitively) followed by the resource itself. Cycles are broken arbitrarily.
+		LIBBNDL_EXPORT std::vector<uint32_t> GetLoadOrder(uint32_t resourceID) const;
+
+		LIBBNDL_EXPORT bool HasCycles() const;
+		LIBBNDL_EXPORT std::vector<std::vector<uint32_t>> FindCycles() const;
+
+	private:
+		struct Node
+		{
+			const Bundle *bundle = nullptr;
+			std::vector<uint32_t> dependencies;
+			std::vector<uint32_t> dependents;
+		};
+
+		std::vector<const Bundle *> m_bundles;
+		mutable std::unordered_map<uint32_t, Node> m_nodes;
+		mutable bool m_built = false;
+		mutable std::mutex m_buildMutex;
+
+		void Build() const;
+		const Node *FindNode(uint32_t resourceID) const;
+		std::vector<uint32_t> Walk(uint32_t resourceID, bool dependents) const;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "libbndl_export.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libbndl
+{
+	namespace detail
+	{
+		class MappedFile;
+	}
+
+	// Maps resource IDs back to names, for bundles without a resource string table. Names are hashed
+	// the same way as Bundle does. Saved dictionaries are memory mapped on load instead of being read in.
+	class NameDictionary
+	{
+	public:
+		LIBBNDL_EXPORT NameDictionary();
+		LIBBNDL_EXPORT ~NameDictionary();
+
+		// Names are stored with 32-bit offsets, so adding fails once they would take more than 4 GiB;
+		// nothing is added then.
+		LIBBNDL_EXPORT bool Add(const std::string &name);
+		// Names are hashed on all cores.
+		LIBBNDL_EXPORT bool Add(const std::vector<std::string> &names);
+		// One name per line.
+		LIBBNDL_EXPORT bool AddFile(const std::string &name);
+
+		LIBBNDL_EXPORT bool Load(const std::string &name);
+		LIBBNDL_EXPORT bool Save(const std::string &name) const;
+
+		LIBBNDL_EXPORT size_t GetSize() const;
+
+		// If several names share an ID, the first in byte order is returned. The view is valid until
+		// the dictionary is next modified, loaded or destroyed.
+		LIBBNDL_EXPORT std::optional<std::string_view> Lookup(uint32_t resourceID) const;
+
+	private:
+		struct Entry
+		{
+			uint32_t resourceID;
+			uint32_t nameOffset; // into m_names, or the mapped name block
+		};
+
+		mutable std::vector<Entry> m_entries;
+		std::string m_names; // null terminated names, back to back
+		mutable std::atomic<bool> m_sorted = true;
+		mutable std::mutex m_sortMutex;
+
+		std::unique_ptr<detail::MappedFile> m_file;
+		uint32_t m_mappedCount = 0;
+
+		bool AddHashed(const std::vector<std::string_view> &names);
+		void Materialize();
+		void Sort() const;
+		std::string_view GetName(uint32_t nameOffset) const;
+	};
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "libbndl_export.h"
+#include <libbndl/bundle.hpp>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace libbndl
+{
+	// Sorted index over the resource string table names and type names of one or more bundles.
+	// Names are copied in, so the bundles do not need to outlive the index.
+	class NameIndex
+	{
+	public:
+		enum MatchMode
+		{
+			Prefix,
+			Substring,
+			Glob // * and ?
+		};
+
+		enum Field
+		{
+			Name,
+			TypeName
+		};
+
+		struct Match
+		{
+			uint32_t resourceID;
+			size_t bundle; // as returned by AddBundle or AddDebugInfo
+			std::string name;
+			std::string typeName;
+		};
+
+		LIBBNDL_EXPORT NameIndex() = default;
+		LIBBNDL_EXPORT explicit NameIndex(const Bundle &bundle);
+
+		// Safe to call from several threads at once.
+		LIBBNDL_EXPORT size_t AddBundle(const Bundle &bundle);
+		// For tables read with Bundle::ReadDebugInfo, without loading the bundle.
+		LIBBNDL_EXPORT size_t AddDebugInfo(const std::map<uint32_t, Bundle::EntryDebugInfo> &debugInfoEntries);
+		LIBBNDL_EXPORT size_t GetSize() const;
+
+		// Case insensitive, like resource name hashing. Matches are sorted by the searched field.
+		LIBBNDL_EXPORT std::vector<Match> Search(const std::string &pattern, MatchMode mode = Substring, Field field = Name) const;
+
+	private:
+		struct Record
+		{
+			uint32_t resourceID;
+			uint32_t bundle;
+			std::string name;
+			std::string typeName;
+		};
+
+		std::vector<Record> m_records;
+		uint32_t m_bundleCount = 0;
+		mutable std::vector<std::pair<std::string, uint32_t>> m_keys[2]; // lowercase field, record index
+		mutable bool m_built = false;
+		mutable std::mutex m_mutex;
+
+		size_t AddRecords(std::vector<Record> records);
+		void Build() const;
+	};
+}
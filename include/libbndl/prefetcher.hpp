@@ -0,0 +1,45 @@
+#pragma once
+#include "libbndl_export.h"
+#include <libbndl/bundle.hpp>
+#include <libbndl/dependencygraph.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
+
+namespace libbndl
+{
+	namespace detail
+	{
+		class ThreadPool;
+	}
+
+	struct PrefetchedResource
+	{
+		uint32_t resourceID;
+		std::future<std::optional<Bundle::EntryData>> data; // empty if the prefetch was cancelled
+	};
+
+	// Reads and decompresses a resource and everything it imports on background threads.
+	// The bundles (and graph) must outlive the prefetcher.
+	class Prefetcher
+	{
+	public:
+		LIBBNDL_EXPORT explicit Prefetcher(const Bundle &bundle, unsigned threads = 0);
+		LIBBNDL_EXPORT explicit Prefetcher(const DependencyGraph &graph, unsigned threads = 0);
+		LIBBNDL_EXPORT ~Prefetcher();
+
+		// Queues the resource's imports (transitively) followed by the resource itself, dependencies first.
+		// Queuing stops at the first resource that would take the total uncompressed size over memoryBudget,
+		// so whatever is returned is a prefix of the load order and never lacks one of its imports.
+		LIBBNDL_EXPORT std::vector<PrefetchedResource> Prefetch(uint32_t resourceID, size_t memoryBudget);
+
+		// Jobs that have not started yet complete immediately with an empty result.
+		LIBBNDL_EXPORT void Cancel();
+
+	private:
+		std::unique_ptr<DependencyGraph> m_ownedGraph;
+		const DependencyGraph &m_graph;
+		std::atomic<uint32_t> m_generation = 0;
+		std::unique_ptr<detail::ThreadPool> m_pool;
+	};
+}
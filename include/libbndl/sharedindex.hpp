@@ -0,0 +1,57 @@
+#pragma once
+#include "libbndl_export.h"
+#include <libbndl/bundle.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace libbndl
+{
+	namespace detail
+	{
+		class MappedFile;
+	}
+
+	// Read-only view of a bundle for processes that all serve the same files. The entry tables, imports
+	// and debug names are parsed once into an index file with an offset-based layout; every process then
+	// maps that index and the bundle itself, so all of them share the same pages. Put the index in
+	// /dev/shm (or another tmpfs) to keep it in shared memory.
+	class SharedIndex
+	{
+	public:
+		LIBBNDL_EXPORT SharedIndex();
+		LIBBNDL_EXPORT ~SharedIndex();
+
+		LIBBNDL_EXPORT static bool Build(const std::string &bundleName, const std::string &indexName);
+		// Fails if the bundle's size or modification time changed since the index was built.
+		LIBBNDL_EXPORT bool Open(const std::string &indexName, const std::string &bundleName);
+		LIBBNDL_EXPORT void Close();
+
+		// Header fields are only valid while open.
+		LIBBNDL_EXPORT Bundle::MagicVersion GetMagicVersion() const;
+		LIBBNDL_EXPORT uint32_t GetRevisionNumber() const;
+		LIBBNDL_EXPORT Bundle::Platform GetPlatform() const;
+		LIBBNDL_EXPORT Bundle::Flags GetFlags() const;
+
+		LIBBNDL_EXPORT std::vector<uint32_t> ListResourceIDs() const;
+		LIBBNDL_EXPORT std::optional<Bundle::ResourceType> GetResourceType(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::optional<Bundle::EntryDebugInfo> GetDebugInfo(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::optional<std::vector<Bundle::Dependency>> GetDependencies(uint32_t resourceID) const;
+		LIBBNDL_EXPORT std::optional<uint32_t> GetUncompressedSize(uint32_t resourceID, uint32_t fileBlock) const;
+		// The block as stored in the bundle (compressed, if the bundle is), in place in the mapping.
+		LIBBNDL_EXPORT std::optional<Bundle::DataView> GetStoredData(uint32_t resourceID, uint32_t fileBlock) const;
+		LIBBNDL_EXPORT std::unique_ptr<std::vector<uint8_t>> GetBinary(uint32_t resourceID, uint32_t fileBlock) const;
+
+	private:
+		struct Header;
+		struct Entry;
+
+		const Header &GetHeader() const;
+		const Entry *FindEntry(uint32_t resourceID) const;
+
+		std::unique_ptr<detail::MappedFile> m_index;
+		std::unique_ptr<detail::MappedFile> m_bundle;
+	};
+}
@@ -0,0 +1,52 @@
+#include <libbndl/accesstrace.hpp>
+#include <fstream>
+#include <iomanip>
+
+using namespace libbndl;
+
+void AccessTrace::Record(uint32_t resourceID)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_seen.insert(resourceID).second)
+		m_order.push_back(resourceID);
+}
+
+void AccessTrace::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_order.clear();
+	m_seen.clear();
+}
+
+std::vector<uint32_t> AccessTrace::GetOrder() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_order;
+}
+
+bool AccessTrace::Load(const std::string &name)
+{
+	std::ifstream stream(name);
+	if (stream.fail())
+		return false;
+
+	Clear();
+
+	uint32_t resourceID;
+	while (stream >> std::hex >> resourceID)
+		Record(resourceID);
+
+	return stream.eof();
+}
+
+bool AccessTrace::Save(const std::string &name) const
+{
+	std::ofstream stream(name);
+	if (stream.fail())
+		return false;
+
+	for (const auto resourceID : GetOrder())
+		stream << std::hex << std::setw(8) << std::setfill('0') << resourceID << '\n';
+
+	return !stream.fail();
+}
@@ -9,25 +9,111 @@
 #include <regex>
 #include <iomanip>
 #include <array>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <libbndl/accesstrace.hpp>
+#include <libbndl/decompressioncache.hpp>
+#include <libbndl/dependencygraph.hpp>
+#include "byteswap.hpp"
+#include "codec.hpp"
+#include "hash.hpp"
+#include "inflateindex.hpp"
+#include "parallel.hpp"
+#include "system.hpp"
 
 using namespace libbndl;
 
 #ifndef __has_builtin
 #	define __has_builtin(x) 0
 #endif
-inline unsigned long BitScanReverse(unsigned long input)
+inline uint32_t BitScanReverse(uint32_t input)
 {
+	if (input == 0)
+		return 0;
+
 	unsigned long result;
 
 #if defined(_MSC_VER)
 	_BitScanReverse(&result, input);
-#elif __has_builtin(__builtin_clzl) || defined(__GNUC__)
-	result = static_cast<unsigned long>(31 - __builtin_clzl(input));
+#elif __has_builtin(__builtin_clz) || defined(__GNUC__)
+	result = static_cast<unsigned long>(31 - __builtin_clz(input));
 #else
 #	error "Unsupported compiler."
 #endif
 
-	return result;
+	return static_cast<uint32_t>(result);
+}
+
+namespace
+{
+	constexpr uint32_t SeekIndexVersion = 1;
+	constexpr uint32_t PatchVersion = 1;
+
+	off_t AlignOffset(off_t offset, uint32_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// Tracks the blocks already written to the current data block, keyed by content.
+	class BlockDeduplicator
+	{
+	public:
+		// Returns where an identical block was previously written, or records this one at `offset`.
+		uint32_t FindOrAdd(const uint8_t *data, uint32_t size, uint32_t offset)
+		{
+			auto &candidates = m_blocks[libbndl::detail::XXH64::Hash(data, size)];
+			for (const auto &candidate : candidates)
+			{
+				if (candidate.size == size && std::memcmp(candidate.data, data, size) == 0)
+					return candidate.offset;
+			}
+
+			candidates.push_back({ data, size, offset });
+			return offset;
+		}
+
+		void Clear()
+		{
+			m_blocks.clear();
+		}
+
+	private:
+		struct StoredBlock
+		{
+			const uint8_t *data;
+			uint32_t size;
+			uint32_t offset;
+		};
+
+		std::unordered_map<uint64_t, std::vector<StoredBlock>> m_blocks;
+	};
+
+	// Inflates into a scratch buffer, so blocks of any size are checked in constant memory.
+	bool IsZlibStreamValid(const uint8_t *data, uint32_t compressedSize, uint32_t uncompressedSize)
+	{
+		thread_local std::vector<uint8_t> scratch(0x10000);
+
+		z_stream stream = {};
+		if (inflateInit(&stream) != Z_OK)
+			return false;
+
+		stream.next_in = const_cast<Bytef *>(data);
+		stream.avail_in = compressedSize;
+
+		uint64_t totalOut = 0;
+		int ret;
+		do
+		{
+			stream.next_out = scratch.data();
+			stream.avail_out = static_cast<uInt>(scratch.size());
+			ret = inflate(&stream, Z_NO_FLUSH);
+			totalOut += scratch.size() - stream.avail_out;
+		} while (ret == Z_OK && totalOut <= uncompressedSize);
+
+		inflateEnd(&stream);
+		return ret == Z_STREAM_END && totalOut == uncompressedSize;
+	}
 }
 
 Bundle::Bundle(MagicVersion magicVersion, uint32_t revisionNumber, Platform platform, Flags flags)
@@ -38,24 +124,90 @@ Bundle::Bundle(MagicVersion magicVersion, uint32_t revisionNumber, Platform plat
 	m_flags = flags;
 }
 
-bool Bundle::Load(const std::string &name)
+Bundle Bundle::Snapshot() const
+{
+	return *this;
+}
+
+std::shared_ptr<std::vector<uint8_t>> Bundle::ReadFile(const std::string &name)
 {
 	std::ifstream stream;
 
-	stream.open(name, std::ios::in | std::ios::binary | std::ios::ate);
+	stream.open(name, std::ios::in | std::ios::binary);
 
 	// Check if archive exists
 	if (stream.fail())
+		return nullptr;
+
+	return ReadStream(stream);
+}
+
+std::shared_ptr<std::vector<uint8_t>> Bundle::ReadStream(std::istream &stream)
+{
+	const auto start = stream.tellg();
+	stream.seekg(0, std::ios::end);
+	const auto end = stream.tellg();
+	if (start == std::istream::pos_type(-1) || end == std::istream::pos_type(-1))
+		return nullptr;
+
+	stream.seekg(start);
+	const auto &buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(end - start));
+	stream.read(reinterpret_cast<char *>(buffer->data()), buffer->size());
+	if (stream.fail())
+		return nullptr;
+
+	return buffer;
+}
+
+bool Bundle::Load(const std::string &name)
+{
+	const auto buffer = ReadFile(name);
+	if (buffer == nullptr)
 		return false;
 
-	const auto fileSize = stream.tellg();
-	if (fileSize < 4)
+	return LoadBuffer(buffer);
+}
+
+bool Bundle::Load(const std::shared_ptr<std::vector<uint8_t>> &buffer)
+{
+	if (buffer == nullptr)
+		return false;
+
+	return LoadBuffer(buffer);
+}
+
+bool Bundle::Load(const uint8_t *data, size_t size)
+{
+	if (data == nullptr)
+		return false;
+
+	// Entries keep copies of their blocks, so the caller's memory is not referenced after loading.
+	return LoadBuffer(std::make_shared<std::vector<uint8_t>>(data, data + size));
+}
+
+bool Bundle::Load(std::istream &stream)
+{
+	const auto buffer = ReadStream(stream);
+	if (buffer == nullptr)
+		return false;
+
+	return LoadBuffer(buffer);
+}
+
+bool Bundle::Load(const std::string &name, const LoadProgress &progress)
+{
+	const auto buffer = ReadFile(name);
+	if (buffer == nullptr)
+		return false;
+
+	return LoadBuffer(buffer, nullptr, progress ? &progress : nullptr);
+}
+
+bool Bundle::LoadBuffer(const std::shared_ptr<std::vector<uint8_t>> &buffer, BlockOffsets *blockOffsets, const LoadProgress *progress, bool readData)
+{
+	if (buffer->size() < 4)
 		return false;
 
-	stream.seekg(0, std::ios::beg);
-	const auto &buffer = std::make_shared<std::vector<uint8_t>>(fileSize);
-	stream.read(reinterpret_cast<char *>(buffer->data()), fileSize);
-	stream.close();
 	auto reader = binaryio::BinaryReader(buffer);
 
 	// Check if it's a BNDL archive
@@ -67,42 +219,65 @@ bool Bundle::Load(const std::string &name)
 	else
 		return false;
 
-	return (m_magicVersion == BNDL) ? LoadBNDL(reader): LoadBND2(reader);
+	const auto loaded = (m_magicVersion == BNDL) ? LoadBNDL(reader, blockOffsets, progress, readData) : LoadBND2(reader, blockOffsets, progress, readData);
+	RebuildTypeIndex();
+	return loaded;
 }
 
-bool Bundle::LoadBND2(binaryio::BinaryReader &reader)
+bool Bundle::ReadBND2Header(binaryio::BinaryReader &reader, BND2Header &header)
 {
-	m_revisionNumber = reader.Read<uint32_t>();
+	header.revisionNumber = reader.Read<uint32_t>();
 
-	m_platform = reader.Read<Platform>();
-	reader.SetBigEndian(m_platform != PC);
+	header.platform = reader.Read<Platform>();
+	reader.SetBigEndian(header.platform != PC);
 
 	if (reader.IsBigEndian())
-		m_revisionNumber = (m_revisionNumber << 24) | (m_revisionNumber << 8 & 0xff0000) | (m_revisionNumber >> 8 & 0xff00) | (m_revisionNumber >> 24);
+		header.revisionNumber = (header.revisionNumber << 24) | (header.revisionNumber << 8 & 0xff0000) | (header.revisionNumber >> 8 & 0xff00) | (header.revisionNumber >> 24);
 	// Little sanity check.
-	if (m_revisionNumber != 2)
+	if (header.revisionNumber != 2)
 		return false;
 
-	const auto rstOffset = reader.Read<uint32_t>();
-	const auto numEntries = reader.Read<uint32_t>();
+	header.rstOffset = reader.Read<uint32_t>();
+	header.numEntries = reader.Read<uint32_t>();
 
-	const auto idBlockOffset = reader.Read<uint32_t>();
-	uint32_t fileBlockOffsets[3];
-	fileBlockOffsets[0] = reader.Read<uint32_t>();
-	fileBlockOffsets[1] = reader.Read<uint32_t>();
-	fileBlockOffsets[2] = reader.Read<uint32_t>();
+	header.idBlockOffset = reader.Read<uint32_t>();
+	header.fileBlockOffsets[0] = reader.Read<uint32_t>();
+	header.fileBlockOffsets[1] = reader.Read<uint32_t>();
+	header.fileBlockOffsets[2] = reader.Read<uint32_t>();
 
-	m_flags = reader.Read<Flags>();
+	header.flags = reader.Read<Flags>();
 
 	// Last 8 bytes are padding.
 
+	return true;
+}
+
+bool Bundle::LoadBND2(binaryio::BinaryReader &reader, BlockOffsets *blockOffsets, const LoadProgress *progress, bool readData)
+{
+	BND2Header header;
+	if (!ReadBND2Header(reader, header))
+		return false;
+
+	m_revisionNumber = header.revisionNumber;
+	m_platform = header.platform;
+	m_flags = header.flags;
+
+	const auto rstOffset = header.rstOffset;
+	const auto numEntries = header.numEntries;
+	const auto idBlockOffset = header.idBlockOffset;
+	const auto &fileBlockOffsets = header.fileBlockOffsets;
 
 	m_entries.clear();
 	m_debugInfoEntries.clear();
+	m_dependencies.clear();
+	m_seekIndex.clear();
 
 	reader.Seek(idBlockOffset);
 	for (auto i = 0U; i < numEntries; i++)
 	{
+		if (progress != nullptr && i % 256 == 0 && !(*progress)(i, numEntries))
+			return false;
+
 		// These are stored in bundle as 64-bit (8-byte), but are really 32-bit.
 		auto resourceID = static_cast<uint32_t>(reader.Read<uint64_t>());
 		assert(resourceID != 0);
@@ -127,17 +302,20 @@ bool Bundle::LoadBND2(binaryio::BinaryReader &reader)
 		auto dataReader = reader.Copy();
 		for (auto j = 0; j < 3; j++)
 		{
-			dataReader.Seek(fileBlockOffsets[j] + reader.Read<uint32_t>()); // Read offset
+			const auto readOffset = fileBlockOffsets[j] + reader.Read<uint32_t>();
+			if (blockOffsets != nullptr)
+				(*blockOffsets)[resourceID][j] = readOffset;
 
 			auto &dataInfo = e.fileBlockData[j];
 
 			const auto readSize = (m_flags & Compressed) ? dataInfo.compressedSize : dataInfo.uncompressedSize;
-			if (readSize == 0)
+			if (readSize == 0 || !readData)
 			{
 				dataInfo.data = nullptr;
 				continue;
 			}
 
+			dataReader.Seek(readOffset);
 			const auto readBuffer = dataReader.Read<uint8_t *>(readSize);
 			dataInfo.data = std::make_unique<std::vector<uint8_t>>(readBuffer, readBuffer + readSize);
 			delete[] readBuffer;
@@ -150,45 +328,25 @@ bool Bundle::LoadBND2(binaryio::BinaryReader &reader)
 		reader.Seek(2, std::ios::cur); // Padding
 	}
 
+	if (progress != nullptr && !(*progress)(numEntries, numEntries))
+		return false;
+
 	if (m_flags & HasResourceStringTable)
 	{
 		reader.Seek(rstOffset, std::ios::beg);
 
-		const auto rstXML = reader.ReadString();
-
-		pugi::xml_document doc;
-		if (doc.load_string(rstXML.c_str(), pugi::parse_minimal))
-		{
-			for (const auto resource : doc.child("ResourceStringTable").children("Resource"))
-			{
-				const auto resourceID = std::stoul(resource.attribute("id").value(), nullptr, 16);
-				auto &debugInfo = m_debugInfoEntries[resourceID];
-				debugInfo.name = resource.attribute("name").value();
-				debugInfo.typeName = resource.attribute("type").value();
-			}
-		}
+		ParseResourceStringTable(reader.ReadString(), m_debugInfoEntries);
 	}
 
 	return true;
 }
 
-bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
+bool Bundle::LoadBNDL(binaryio::BinaryReader &reader, BlockOffsets *blockOffsets, const LoadProgress *progress, bool readData)
 {
-	m_platform = static_cast<Platform>(0);
-	auto platformReader = reader.Copy();
-	for (const auto offset : { 0x4C, 0x58, 0x64 })
-	{
-		platformReader.Seek(offset);
-		const auto platform = platformReader.Read<Platform>();
-		if (platform == PC || platform == Xbox360 || platform == PS3)
-		{
-			m_platform = platform;
-			reader.SetBigEndian(m_platform != PC);
-			break;
-		}
-	}
+	m_platform = ReadBNDLPlatform(reader);
 	if (m_platform == 0)
 		return false;
+	reader.SetBigEndian(m_platform != PC);
 
 	m_revisionNumber = reader.Read<uint32_t>();
 	if (m_revisionNumber < 3 || m_revisionNumber > 5)
@@ -243,6 +401,7 @@ bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
 	m_entries.clear();
 	m_debugInfoEntries.clear();
 	m_dependencies.clear();
+	m_seekIndex.clear();
 
 	reader.Seek(idListOffset);
 	std::vector<uint32_t> resourceIDs;
@@ -250,8 +409,12 @@ bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
 		resourceIDs.push_back(static_cast<uint32_t>(reader.Read<uint64_t>()));
 
 	reader.Seek(idTableOffset);
-	for (const auto resourceID : resourceIDs)
+	for (auto i = 0U; i < numEntries; i++)
 	{
+		if (progress != nullptr && i % 256 == 0 && !(*progress)(i, numEntries))
+			return false;
+
+		const auto resourceID = resourceIDs[i];
 		auto &e = m_entries[resourceID];
 
 		reader.Skip<uint32_t>(); // unknown mem stuff
@@ -311,9 +474,11 @@ bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
 			}
 
 			auto &dataInfo = e.fileBlockData[mappedBlock];
+			if (blockOffsets != nullptr)
+				(*blockOffsets)[resourceID][mappedBlock] = readOffset;
 
 			const auto readSize = compressed ? dataInfo.compressedSize : dataInfo.uncompressedSize;
-			if (readSize == 0)
+			if (readSize == 0 || !readData)
 			{
 				dataInfo.data = nullptr;
 				continue;
@@ -329,6 +494,9 @@ bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
 		reader.Seek(0x4 * blocks, std::ios::cur); // memory address stuff
 	}
 
+	if (progress != nullptr && !(*progress)(numEntries, numEntries))
+		return false;
+
 	if (compressed)
 	{
 		reader.Seek(uncompInfoOffset);
@@ -367,45 +535,43 @@ bool Bundle::LoadBNDL(binaryio::BinaryReader &reader)
 			m_dependencies[resourceID].emplace_back(ReadDependency(reader));
 	}
 
-	auto rstFile = GetBinary(0xC039284A, 0);
+	auto rstFile = ReadBlock(0xC039284A, 0);
 	if (rstFile == nullptr)
 		return true;
 
 	m_flags = static_cast<Flags>(m_flags | HasResourceStringTable);
+	ParseResourceStringTable(ReadBNDLResourceStringTable(std::move(rstFile)), m_debugInfoEntries);
 
-	auto rstReader = binaryio::BinaryReader(std::move(rstFile));
-
-	const auto strLen = rstReader.Read<uint32_t>();
-	auto rstXML = rstReader.ReadString(strLen);
+	m_entries.erase(0xC039284A);
+	if (blockOffsets != nullptr)
+		blockOffsets->erase(0xC039284A);
 
-	// Cover Criterion's broken XML writer.
-	if (rstXML.rfind("</ResourceStringTable>", 0) == 0)
-		rstXML.erase(1, 1);
-	const auto pos = rstXML.find("</ResourceStringTable>\n\t");
-	if (pos != std::string::npos)
-		rstXML.erase(pos, 23);
+	return true;
+}
 
-	pugi::xml_document doc;
-	if (doc.load_string(rstXML.c_str(), pugi::parse_minimal))
+Bundle::Platform Bundle::ReadBNDLPlatform(const binaryio::BinaryReader &reader)
+{
+	// The platform field moves with the number of blocks, which itself depends on the platform.
+	auto platformReader = reader.Copy();
+	for (const auto offset : { 0x4C, 0x58, 0x64 })
 	{
-		for (const auto resource : doc.child("ResourceStringTable").children("Resource"))
-		{
-			const auto resourceID = std::stoul(resource.attribute("id").value(), nullptr, 16);
-			auto &debugInfo = m_debugInfoEntries[resourceID];
-			debugInfo.name = resource.attribute("name").value();
-			debugInfo.typeName = resource.attribute("type").value();
-		}
+		platformReader.Seek(offset);
+		const auto platform = platformReader.Read<Platform>();
+		if (platform == PC || platform == Xbox360 || platform == PS3)
+			return platform;
 	}
-
-	m_entries.erase(0xC039284A);
-
-	return true;
+	return static_cast<Platform>(0);
 }
 
 int8_t Bundle::MapBNDLBlockToBND2(uint8_t block) const
+{
+	return MapBNDLBlockToBND2(m_platform, block);
+}
+
+int8_t Bundle::MapBNDLBlockToBND2(Platform platform, uint8_t block)
 {
 	auto mappedBlock = block;
-	switch (m_platform)
+	switch (platform)
 	{
 	case PC:
 		if (block >= 3)
@@ -430,19 +596,139 @@ int8_t Bundle::MapBNDLBlockToBND2(uint8_t block) const
 	return mappedBlock;
 }
 
+std::vector<uint32_t> Bundle::GetLayoutOrder(const SaveOptions &options) const
+{
+	std::vector<uint32_t> order;
+	order.reserve(m_entries.size());
+
+	switch (options.order)
+	{
+	case OrderByType:
+		for (const auto &resourceIDs : m_resourceIDsByType)
+			order.insert(order.end(), resourceIDs.second.begin(), resourceIDs.second.end());
+		return order;
+
+	case OrderByDependencies:
+	{
+		// Post-order walk, so a resource directly follows whatever it imports from this bundle.
+		const DependencyGraph graph(*this);
+		std::unordered_set<uint32_t> visited;
+		std::vector<std::pair<uint32_t, size_t>> stack;
+		for (const auto &entry : m_entries)
+		{
+			if (!visited.insert(entry.first).second)
+				continue;
+
+			stack.emplace_back(entry.first, 0);
+			while (!stack.empty())
+			{
+				auto &[resourceID, next] = stack.back();
+				const auto &dependencies = graph.GetDependencies(resourceID);
+				if (next < dependencies.size())
+				{
+					const auto dependency = dependencies[next++];
+					if (m_entries.find(dependency) != m_entries.end() && visited.insert(dependency).second)
+						stack.emplace_back(dependency, 0);
+					continue;
+				}
+
+				order.push_back(resourceID);
+				stack.pop_back();
+			}
+		}
+		return order;
+	}
+
+	case OrderByAccessTrace:
+	{
+		const auto *trace = (options.accessTrace != nullptr) ? options.accessTrace : m_accessTrace.get();
+		std::unordered_set<uint32_t> placed;
+		if (trace != nullptr)
+		{
+			for (const auto resourceID : trace->GetOrder())
+			{
+				if (m_entries.find(resourceID) != m_entries.end() && placed.insert(resourceID).second)
+					order.push_back(resourceID);
+			}
+		}
+
+		for (const auto &entry : m_entries)
+		{
+			if (placed.find(entry.first) == placed.end())
+				order.push_back(entry.first);
+		}
+		return order;
+	}
+
+	default:
+		return ListResourceIDs();
+	}
+}
+
 bool Bundle::Save(const std::string &name)
+{
+	return Save(name, SaveOptions());
+}
+
+bool Bundle::Save(const std::string &name, const SaveOptions &options, SaveStatistics *statistics)
+{
+	auto writer = binaryio::BinaryWriter();
+	if (!Write(writer, options, statistics))
+		return false;
+
+	std::ofstream f(name, std::ios::out | std::ios::binary);
+	f << writer.GetStream().rdbuf();
+	f.close();
+
+	return !f.fail();
+}
+
+bool Bundle::Save(std::ostream &stream)
+{
+	return Save(stream, SaveOptions());
+}
+
+bool Bundle::Save(std::ostream &stream, const SaveOptions &options, SaveStatistics *statistics)
+{
+	auto writer = binaryio::BinaryWriter();
+	if (!Write(writer, options, statistics))
+		return false;
+
+	stream << writer.GetStream().rdbuf();
+
+	return !stream.fail();
+}
+
+bool Bundle::Save(std::vector<uint8_t> &buffer)
+{
+	return Save(buffer, SaveOptions());
+}
+
+bool Bundle::Save(std::vector<uint8_t> &buffer, const SaveOptions &options, SaveStatistics *statistics)
 {
 	auto writer = binaryio::BinaryWriter();
+	if (!Write(writer, options, statistics))
+		return false;
+
+	const auto data = writer.GetStream().str();
+	buffer.assign(data.begin(), data.end());
+
+	return true;
+}
+
+bool Bundle::Write(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics *statistics)
+{
+	SaveStatistics saveStatistics;
 
 	switch (m_magicVersion)
 	{
 	case BNDL:
-		if (!SaveBNDL(writer))
+		if (!SaveBNDL(writer, options, saveStatistics))
 			return false;
 		break;
 
 	case BND2:
-		if (!SaveBND2(writer))
+		if (!SaveBND2(writer, options, saveStatistics))
 			return false;
 		break;
 
@@ -450,19 +736,22 @@ bool Bundle::Save(const std::string &name)
 		return false;
 	}
 
-	std::ofstream f(name, std::ios::out | std::ios::binary);
-	f << writer.GetStream().rdbuf();
-	f.close();
+	if (statistics != nullptr)
+		*statistics = saveStatistics;
 
 	return true;
 }
 
 
-bool Bundle::SaveBND2(binaryio::BinaryWriter &writer)
+bool Bundle::SaveBND2(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics &statistics)
 {
 	writer.Write("bnd2", 4);
+	writer.SetBigEndian(m_platform != PC);
 	writer.Write<uint32_t>(2); // Bundle version
-	writer.Write(PC); // Only PC writing supported for now.
+
+	writer.SetBigEndian(false);
+	writer.Write<uint32_t>(m_platform);
+	writer.SetBigEndian(m_platform != PC);
 
 	auto rstPointerPos = writer.GetOffset();
 	writer.Seek(4, std::ios::cur); // write later
@@ -523,7 +812,7 @@ bool Bundle::SaveBND2(binaryio::BinaryWriter &writer)
 		writer.Write<uint64_t>(e.info.checksum);
 
 		for (auto &dataInfo : e.fileBlockData)
-			writer.Write(dataInfo.uncompressedSize | (BitScanReverse(dataInfo.uncompressedAlignment) << 28));
+			writer.Write<uint32_t>(dataInfo.uncompressedSize | (BitScanReverse(dataInfo.uncompressedAlignment) << 28));
 		for (auto &dataInfo : e.fileBlockData)
 			writer.Write(dataInfo.compressedSize);
 		for (auto j = 0; j < 3; j++)
@@ -542,27 +831,52 @@ bool Bundle::SaveBND2(binaryio::BinaryWriter &writer)
 	}
 
 	// DATA BLOCK
+	const auto layoutOrder = GetLayoutOrder(options);
+	std::unordered_map<uint32_t, size_t> entryIndices;
+	entryIndices.reserve(m_entries.size());
+	for (const auto &entry : m_entries)
+		entryIndices.emplace(entry.first, entryIndices.size());
+
+	const auto pageAlign = options.pageAlignBlocks && (m_flags & Compressed) == 0;
+	const auto pageSize = detail::PageSize();
+
+	BlockDeduplicator deduplicator;
 	for (auto i = 0; i < 3; i++)
 	{
+		if (pageAlign)
+			writer.Align(pageSize);
+
 		const auto blockStart = writer.GetOffset();
 		writer.VisitAndWrite<uint32_t>(fileBlockPointerPos[i], blockStart);
+		deduplicator.Clear();
 
-		entryIter = m_entries.begin();
-		for (auto j = 0U; j < m_entries.size(); j++)
+		for (auto k = 0U; k < layoutOrder.size(); k++)
 		{
-			const auto &e = entryIter->second;
+			const auto j = entryIndices.at(layoutOrder[k]);
+			const auto &e = m_entries.at(layoutOrder[k]);
 
 			const auto &dataInfo = e.fileBlockData[i];
 			const auto readSize = (m_flags & Compressed) ? dataInfo.compressedSize : dataInfo.uncompressedSize;
 
 			if (readSize > 0)
 			{
-				writer.VisitAndWrite<uint32_t>(entryDataPointerPos[j][i], writer.GetOffset() - blockStart);
-				writer.Write(dataInfo.data->data(), readSize);
-				writer.Align((i != 0 && j != m_entries.size() - 1) ? 0x80 : 16);
-			}
+				const auto alignment = pageAlign ? std::max(pageSize, dataInfo.uncompressedAlignment) : 1U;
+				const auto offset = static_cast<uint32_t>(AlignOffset(writer.GetOffset(), alignment) - blockStart);
+				const auto storedOffset = options.deduplicateBlocks ? deduplicator.FindOrAdd(dataInfo.data->data(), readSize, offset) : offset;
+				writer.VisitAndWrite<uint32_t>(entryDataPointerPos[j][i], storedOffset);
 
-			entryIter = std::next(entryIter);
+				if (storedOffset != offset)
+				{
+					statistics.deduplicatedBlocks++;
+					statistics.bytesSaved += readSize;
+				}
+				else
+				{
+					writer.Align(alignment);
+					writer.Write(dataInfo.data->data(), readSize);
+					writer.Align((i != 0 && k != layoutOrder.size() - 1) ? 0x80 : 16);
+				}
+			}
 		}
 
 		if (i != 2)
@@ -572,7 +886,7 @@ bool Bundle::SaveBND2(binaryio::BinaryWriter &writer)
 	return true;
 }
 
-bool Bundle::SaveBNDL(binaryio::BinaryWriter &writer)
+bool Bundle::SaveBNDL(binaryio::BinaryWriter &writer, const SaveOptions &options, SaveStatistics &statistics)
 {
 	if (m_revisionNumber <= 3 && (m_flags & Compressed) != 0)
 		return false; // Invalid combination
@@ -629,7 +943,7 @@ bool Bundle::SaveBNDL(binaryio::BinaryWriter &writer)
 	{
 		writer.Write<uint32_t>(m_flags & Compressed);
 		writer.Write<uint32_t>((m_flags & Compressed) ? entryCount : 0);
-		auto uncompInfoBlockPointerPos = writer.GetOffset();
+		uncompInfoBlockPointerPos = writer.GetOffset();
 		writer.Write<uint32_t>(0); // will write later, but only if needed
 	}
 
@@ -682,6 +996,7 @@ bool Bundle::SaveBNDL(binaryio::BinaryWriter &writer)
 		e.fileBlockData[0].data = std::make_unique<std::vector<uint8_t>>(data.begin(), data.end());
 		e.fileBlockData[0].uncompressedSize = static_cast<uint32_t>(data.size());
 		e.fileBlockData[0].uncompressedAlignment = 4;
+		IndexResource(0xFFFFFFFF);
 	}
 
 	// ID TABLE
@@ -781,39 +1096,69 @@ bool Bundle::SaveBNDL(binaryio::BinaryWriter &writer)
 	}
 
 	// DATA
+	const auto pageAlign = options.pageAlignBlocks && (m_flags & Compressed) == 0;
+	const auto pageSize = detail::PageSize();
+	if (pageAlign)
+		writer.Align(pageSize);
+
 	writer.VisitAndWrite<uint32_t>(dataBlockPointerPos, writer.GetOffset());
 	off_t blockStartOffset = 0;
+	const auto layoutOrder = GetLayoutOrder(options);
+	BlockDeduplicator deduplicator;
 	for (auto i = 0; i < 3; i++)
 	{
-		for (const auto &entry : m_entries)
+		deduplicator.Clear();
+
+		for (const auto resourceID : layoutOrder)
 		{
-			const auto &e = entry.second;
+			const auto &e = m_entries.at(resourceID);
 
 			const auto &dataInfo = e.fileBlockData[i];
 			const auto readSize = (m_flags & Compressed) ? dataInfo.compressedSize : dataInfo.uncompressedSize;
 
 			if (readSize > 0)
 			{
-				writer.VisitAndWrite<uint32_t>(filePointerPosMap.at(entry.first).dataBlockPointerPos[i], writer.GetOffset() - blockStartOffset);
-				writer.Write(dataInfo.data->data(), readSize);
+				const auto alignment = pageAlign ? std::max(pageSize, dataInfo.uncompressedAlignment) : 1U;
+				const auto offset = static_cast<uint32_t>(AlignOffset(writer.GetOffset(), alignment) - blockStartOffset);
+				const auto storedOffset = options.deduplicateBlocks ? deduplicator.FindOrAdd(dataInfo.data->data(), readSize, offset) : offset;
+				writer.VisitAndWrite<uint32_t>(filePointerPosMap.at(resourceID).dataBlockPointerPos[i], storedOffset);
+
+				if (storedOffset != offset)
+				{
+					statistics.deduplicatedBlocks++;
+					statistics.bytesSaved += readSize;
+				}
+				else
+				{
+					writer.Align(alignment);
+					writer.Write(dataInfo.data->data(), readSize);
+				}
 			}
 		}
 
+		// Blocks are stored back to back, so page alignment of the next block's data is padded into this one.
+		if (pageAlign && i != 2)
+			writer.Align(pageSize);
+
 		const auto size = writer.GetOffset() - blockStartOffset;
+		auto alignment = (size == 0) ? 1U : ((i >= 1) ? 4096U : 1024U); // TODO: This changes and I don't know the pattern.
+		if (pageAlign && size != 0)
+			alignment = std::max(alignment, pageSize);
 		writer.VisitAndWrite<uint32_t>(dataBlockDescriptorsPos[i], size);
-		writer.VisitAndWrite<uint32_t>(dataBlockDescriptorsPos[i], (size == 0) ? 1 : ((i >= 1) ? 4096 : 1024)); // TODO: This changes and I don't know the pattern.
+		writer.VisitAndWrite<uint32_t>(dataBlockDescriptorsPos[i] + 4, alignment);
 		blockStartOffset = writer.GetOffset();
 	}
 
+	if (m_entries.count(0xFFFFFFFF))
+		UnindexResource(0xFFFFFFFF);
 	m_entries.erase(0xFFFFFFFF);
 
 	return true;
 }
 
-uint32_t Bundle::HashResourceName(std::string resourceName) const
+uint32_t Bundle::HashResourceName(const std::string &resourceName) const
 {
-	std::transform(resourceName.begin(), resourceName.end(), resourceName.begin(), tolower);
-	return crc32_z(0, reinterpret_cast<const Bytef *>(resourceName.c_str()), resourceName.length());
+	return detail::HashResourceName(resourceName.data(), resourceName.size());
 }
 
 Bundle::Dependency Bundle::ReadDependency(binaryio::BinaryReader &reader)
@@ -837,15 +1182,17 @@ std::optional<Bundle::EntryData> Bundle::GetData(uint32_t resourceID) const
 	if (it == m_entries.end())
 		return {};
 
+	if (m_accessTrace)
+		m_accessTrace->Record(resourceID);
+
 	EntryData data;
 	for (auto i = 0; i < 3; i++)
 	{
-		data.fileBlockData[i] = GetBinary(resourceID, i);
+		data.fileBlockData[i] = ReadBlock(resourceID, i);
 		data.alignments[i] = it->second.fileBlockData[i].uncompressedAlignment;
 	}
 
-	const auto numDependencies = it->second.info.numberOfDependencies;
-	if (numDependencies > 0)
+	if (it->second.info.numberOfDependencies > 0)
 	{
 		if (m_magicVersion == BNDL)
 		{
@@ -853,64 +1200,361 @@ std::optional<Bundle::EntryData> Bundle::GetData(uint32_t resourceID) const
 		}
 		else
 		{
-			const auto buffer = std::make_shared<std::vector<uint8_t>>(data.fileBlockData[0]->begin() + it->second.info.dependenciesOffset, data.fileBlockData[0]->end());
-			binaryio::BinaryReader reader(buffer, m_platform != PC);
-			for (auto i = 0U; i < numDependencies; i++)
-				data.dependencies.emplace_back(ReadDependency(reader));
-			data.fileBlockData[0]->resize(data.fileBlockData[0]->size() - buffer->size());
+			data.dependencies = ReadDependencies(it->second.info, *data.fileBlockData[0], m_platform != PC);
+			data.fileBlockData[0]->resize(it->second.info.dependenciesOffset);
 		}
 	}
 
 	return std::move(data);
 }
 
-std::unique_ptr<std::vector<uint8_t>> Bundle::GetBinary(const std::string &resourceName, uint32_t fileBlock) const
+std::optional<std::vector<Bundle::Dependency>> Bundle::GetDependencies(const std::string &resourceName) const
 {
-	return GetBinary(HashResourceName(resourceName), fileBlock);
+	return GetDependencies(HashResourceName(resourceName));
 }
 
-std::unique_ptr<std::vector<uint8_t>> Bundle::GetBinary(uint32_t resourceID, uint32_t fileBlock) const
+std::optional<std::vector<Bundle::Dependency>> Bundle::GetDependencies(uint32_t resourceID) const
 {
 	const auto it = m_entries.find(resourceID);
 	if (it == m_entries.end())
 		return {};
 
-	const auto &e = it->second;
-
-	const auto &dataInfo = e.fileBlockData[fileBlock];
-
-	if (dataInfo.data == nullptr)
-		return {};
+	const auto &info = it->second.info;
+	if (info.numberOfDependencies == 0)
+		return std::vector<Dependency>();
 
-	const auto &buffer = dataInfo.data;
-	const auto uncompressedSize = dataInfo.uncompressedSize;
+	if (m_magicVersion == BNDL)
+		return m_dependencies.at(resourceID);
 
-	auto uncompressedBuffer = std::make_unique<std::vector<uint8_t>>(uncompressedSize);
+	// Only the table is read, so large blocks are not inflated as a whole.
+	const auto uncompressedSize = it->second.fileBlockData[0].uncompressedSize;
+	if (info.dependenciesOffset > uncompressedSize)
+		return std::vector<Dependency>();
 
-	if (dataInfo.compressedSize > 0)
-	{
-		assert(m_flags & Compressed);
+	std::shared_ptr<std::vector<uint8_t>> table = ReadBlockRange(resourceID, 0, info.dependenciesOffset, info.numberOfDependencies * 16);
+	if (table == nullptr)
+		return {};
 
-		uLongf uncompressedSizeLong = uncompressedSize;
-		const auto ret = uncompress(uncompressedBuffer->data(), &uncompressedSizeLong, buffer->data(), static_cast<uLong>(dataInfo.compressedSize));
+	return ReadDependencyTable(table, info.numberOfDependencies, m_platform != PC);
+}
 
-		assert(ret == Z_OK);
-		assert(uncompressedSize == uncompressedSizeLong);
-	}
-	else
-	{
-		std::memcpy(uncompressedBuffer->data(), buffer->data(), uncompressedSize);
-	}
+std::vector<Bundle::Dependency> Bundle::ReadDependencies(const EntryInfo &info, const std::vector<uint8_t> &block, bool bigEndian)
+{
+	std::vector<Dependency> dependencies;
+	if (info.dependenciesOffset > block.size())
+		return dependencies;
 
-	return uncompressedBuffer;
+	const auto buffer = std::make_shared<std::vector<uint8_t>>(block.begin() + info.dependenciesOffset, block.end());
+	return ReadDependencyTable(buffer, info.numberOfDependencies, bigEndian);
 }
 
-std::optional<Bundle::EntryDebugInfo> Bundle::GetDebugInfo(const std::string &resourceName) const
+std::vector<Bundle::Dependency> Bundle::ReadDependencyTable(const std::shared_ptr<std::vector<uint8_t>> &table, size_t count, bool bigEndian)
 {
-	return GetDebugInfo(HashResourceName(resourceName));
+	std::vector<Dependency> dependencies;
+	binaryio::BinaryReader reader(table, bigEndian);
+	const auto numDependencies = std::min<size_t>(count, table->size() / 16);
+	dependencies.reserve(numDependencies);
+	for (auto i = 0U; i < numDependencies; i++)
+		dependencies.emplace_back(ReadDependency(reader));
+
+	return dependencies;
 }
 
-std::optional<Bundle::EntryDebugInfo> Bundle::GetDebugInfo(uint32_t resourceID) const
+std::unique_ptr<std::vector<uint8_t>> Bundle::GetBinary(const std::string &resourceName, uint32_t fileBlock) const
+{
+	return GetBinary(HashResourceName(resourceName), fileBlock);
+}
+
+std::unique_ptr<std::vector<uint8_t>> Bundle::GetBinary(uint32_t resourceID, uint32_t fileBlock) const
+{
+	if (m_accessTrace && m_entries.find(resourceID) != m_entries.end())
+		m_accessTrace->Record(resourceID);
+
+	return ReadBlock(resourceID, fileBlock);
+}
+
+std::optional<Bundle::DataView> Bundle::ReadPrefix(uint32_t resourceID, uint32_t fileBlock, size_t size, std::vector<uint8_t> &scratch) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end() || fileBlock >= 3)
+		return {};
+
+	if (m_accessTrace)
+		m_accessTrace->Record(resourceID);
+
+	const auto &dataInfo = it->second.fileBlockData[fileBlock];
+	if (dataInfo.data == nullptr)
+		return DataView();
+
+	size = std::min<size_t>(size, dataInfo.uncompressedSize);
+	if (dataInfo.compressedSize == 0 || size == 0)
+		return DataView { dataInfo.data->data(), size };
+
+	scratch.resize(size);
+	if (detail::codec::InflatePrefix(dataInfo.data->data(), dataInfo.compressedSize, scratch.data(), size) != size)
+		return {};
+
+	return DataView { scratch.data(), size };
+}
+
+std::unique_ptr<std::vector<uint8_t>> Bundle::ReadPrefix(uint32_t resourceID, uint32_t fileBlock, size_t size) const
+{
+	std::vector<uint8_t> scratch;
+	const auto view = ReadPrefix(resourceID, fileBlock, size, scratch);
+	if (!view || view->data == nullptr)
+		return {};
+
+	if (view->data == scratch.data())
+		return std::make_unique<std::vector<uint8_t>>(std::move(scratch));
+	return std::make_unique<std::vector<uint8_t>>(view->data, view->data + view->size);
+}
+
+std::unique_ptr<std::vector<uint8_t>> Bundle::ReadRange(uint32_t resourceID, uint32_t fileBlock, size_t offset, size_t size) const
+{
+	if (m_accessTrace && m_entries.find(resourceID) != m_entries.end())
+		m_accessTrace->Record(resourceID);
+
+	return ReadBlockRange(resourceID, fileBlock, offset, size);
+}
+
+std::unique_ptr<std::vector<uint8_t>> Bundle::ReadBlockRange(uint32_t resourceID, uint32_t fileBlock, size_t offset, size_t size) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end() || fileBlock >= 3)
+		return {};
+
+	const auto &dataInfo = it->second.fileBlockData[fileBlock];
+	if (dataInfo.data == nullptr || offset > dataInfo.uncompressedSize)
+		return {};
+
+	size = std::min<size_t>(size, dataInfo.uncompressedSize - offset);
+	if (dataInfo.compressedSize == 0)
+		return std::make_unique<std::vector<uint8_t>>(dataInfo.data->begin() + offset, dataInfo.data->begin() + offset + size);
+
+	auto range = std::make_unique<std::vector<uint8_t>>(size);
+	if (size == 0)
+		return range;
+
+	const auto index = m_seekIndex.find({ resourceID, fileBlock });
+	if (index != m_seekIndex.end() && index->second->Matches(dataInfo.compressedSize, dataInfo.uncompressedSize))
+	{
+		if (!index->second->Extract(dataInfo.data->data(), dataInfo.compressedSize, offset, range->data(), size))
+			return {};
+		return range;
+	}
+
+	std::vector<uint8_t> prefix(offset + size);
+	if (detail::codec::InflatePrefix(dataInfo.data->data(), dataInfo.compressedSize, prefix.data(), prefix.size()) != prefix.size())
+		return {};
+
+	std::copy(prefix.begin() + offset, prefix.end(), range->begin());
+	return range;
+}
+
+bool Bundle::BuildSeekIndex(uint32_t spacing, uint32_t minimumSize)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> keys;
+	std::vector<const EntryFileBlockData *> blocks;
+	for (const auto &entry : m_entries)
+	{
+		for (auto i = 0U; i < 3; i++)
+		{
+			const auto &dataInfo = entry.second.fileBlockData[i];
+			if (dataInfo.data == nullptr || dataInfo.compressedSize == 0 || dataInfo.uncompressedSize < minimumSize)
+				continue;
+
+			const auto existing = m_seekIndex.find({ entry.first, i });
+			if (existing != m_seekIndex.end() && existing->second->Matches(dataInfo.compressedSize, dataInfo.uncompressedSize))
+				continue;
+
+			keys.emplace_back(entry.first, i);
+			blocks.push_back(&dataInfo);
+		}
+	}
+
+	std::vector<std::optional<detail::InflateIndex>> indices(blocks.size());
+	detail::ParallelFor(blocks.size(), [&](size_t i)
+	{
+		indices[i] = detail::InflateIndex::Build(blocks[i]->data->data(), blocks[i]->compressedSize, spacing);
+	});
+
+	auto success = true;
+	for (auto i = 0U; i < blocks.size(); i++)
+	{
+		if (indices[i])
+			m_seekIndex[keys[i]] = std::make_shared<const detail::InflateIndex>(std::move(*indices[i]));
+		else
+			success = false;
+	}
+
+	return success;
+}
+
+std::shared_ptr<const Bundle::SeekIndex> Bundle::BuildBlockSeekIndex(uint32_t resourceID, uint32_t fileBlock, const std::atomic<bool> *cancelled, uint32_t spacing) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end() || fileBlock >= 3)
+		return {};
+
+	// The stored bytes stay alive with this reference even if the resource is replaced meanwhile.
+	const auto dataInfo = it->second.fileBlockData[fileBlock];
+	if (dataInfo.data == nullptr || dataInfo.compressedSize == 0)
+		return {};
+
+	auto index = detail::InflateIndex::Build(dataInfo.data->data(), dataInfo.compressedSize, spacing, cancelled);
+	if (!index)
+		return {};
+
+	return std::make_shared<const detail::InflateIndex>(std::move(*index));
+}
+
+bool Bundle::AddSeekIndex(uint32_t resourceID, uint32_t fileBlock, std::shared_ptr<const SeekIndex> index)
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end() || fileBlock >= 3 || index == nullptr)
+		return false;
+
+	// Same sizes are not enough: a replaced block may have them too, and the checkpoints would then be garbage.
+	const auto &dataInfo = it->second.fileBlockData[fileBlock];
+	if (dataInfo.data == nullptr || dataInfo.compressedSize == 0 || !index->Matches(dataInfo.compressedSize, dataInfo.uncompressedSize)
+		|| detail::XXH64::Hash(dataInfo.data->data(), dataInfo.compressedSize) != index->GetStreamHash())
+		return false;
+
+	m_seekIndex[{ resourceID, fileBlock }] = std::move(index);
+	return true;
+}
+
+bool Bundle::HasSeekIndex(uint32_t resourceID, uint32_t fileBlock) const
+{
+	return m_seekIndex.find({ resourceID, fileBlock }) != m_seekIndex.end();
+}
+
+bool Bundle::LoadSeekIndex(const std::string &name)
+{
+	const auto buffer = ReadFile(name);
+	if (buffer == nullptr || buffer->size() < 12 || std::memcmp(buffer->data(), "bndx", 4) != 0)
+		return false;
+
+	auto reader = binaryio::BinaryReader(buffer);
+	reader.Skip<uint32_t>();
+	if (reader.Read<uint32_t>() != SeekIndexVersion)
+		return false;
+
+	decltype(m_seekIndex) seekIndex;
+	const auto count = reader.Read<uint32_t>();
+	for (auto i = 0U; i < count; i++)
+	{
+		if (buffer->size() - reader.GetOffset() < 16)
+			return false;
+
+		const auto resourceID = reader.Read<uint32_t>();
+		const auto fileBlock = reader.Read<uint32_t>();
+		const auto hash = reader.Read<uint64_t>();
+		auto index = detail::InflateIndex::Load(reader, buffer->size() - reader.GetOffset());
+		if (!index)
+			return false;
+
+		// Only keep indexes of blocks that are still stored exactly as they were when indexed.
+		const auto it = m_entries.find(resourceID);
+		if (it == m_entries.end() || fileBlock >= 3)
+			continue;
+
+		const auto &dataInfo = it->second.fileBlockData[fileBlock];
+		if (dataInfo.data == nullptr || dataInfo.compressedSize == 0 || !index->Matches(dataInfo.compressedSize, dataInfo.uncompressedSize)
+			|| detail::XXH64::Hash(dataInfo.data->data(), dataInfo.compressedSize) != hash)
+			continue;
+
+		seekIndex[{ resourceID, fileBlock }] = std::make_shared<const detail::InflateIndex>(std::move(*index));
+	}
+
+	m_seekIndex = std::move(seekIndex);
+	return true;
+}
+
+bool Bundle::SaveSeekIndex(const std::string &name) const
+{
+	auto writer = binaryio::BinaryWriter();
+	writer.Write("bndx", 4);
+	writer.Write<uint32_t>(SeekIndexVersion);
+	writer.Write(static_cast<uint32_t>(m_seekIndex.size()));
+	for (const auto &index : m_seekIndex)
+	{
+		const auto &dataInfo = m_entries.at(index.first.first).fileBlockData[index.first.second];
+		writer.Write<uint32_t>(index.first.first);
+		writer.Write<uint32_t>(index.first.second);
+		writer.Write<uint64_t>(detail::XXH64::Hash(dataInfo.data->data(), dataInfo.compressedSize));
+		index.second->Save(writer);
+	}
+
+	std::ofstream f(name, std::ios::out | std::ios::binary);
+	f << writer.GetStream().rdbuf();
+	f.close();
+
+	return !f.fail();
+}
+
+void Bundle::DropSeekIndex(uint32_t resourceID)
+{
+	for (auto i = 0U; i < 3; i++)
+		m_seekIndex.erase({ resourceID, i });
+}
+
+std::unique_ptr<std::vector<uint8_t>> Bundle::ReadBlock(uint32_t resourceID, uint32_t fileBlock) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end())
+		return {};
+
+	const auto &e = it->second;
+
+	const auto &dataInfo = e.fileBlockData[fileBlock];
+
+	if (dataInfo.data == nullptr)
+		return {};
+
+	const auto &buffer = dataInfo.data;
+	const auto uncompressedSize = dataInfo.uncompressedSize;
+
+	auto uncompressedBuffer = std::make_unique<std::vector<uint8_t>>(uncompressedSize);
+
+	if (dataInfo.compressedSize > 0)
+	{
+		assert(m_flags & Compressed);
+
+		const auto ret = m_decompressionCache
+			? m_decompressionCache->Inflate(buffer->data(), dataInfo.compressedSize, uncompressedBuffer->data(), uncompressedSize)
+			: detail::codec::Inflate(buffer->data(), dataInfo.compressedSize, uncompressedBuffer->data(), uncompressedSize);
+		if (!ret)
+			return {};
+	}
+	else
+	{
+		std::memcpy(uncompressedBuffer->data(), buffer->data(), uncompressedSize);
+	}
+
+	return uncompressedBuffer;
+}
+
+std::optional<uint32_t> Bundle::GetUncompressedSize(const std::string &resourceName, uint32_t fileBlock) const
+{
+	return GetUncompressedSize(HashResourceName(resourceName), fileBlock);
+}
+
+std::optional<uint32_t> Bundle::GetUncompressedSize(uint32_t resourceID, uint32_t fileBlock) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end() || fileBlock >= 3)
+		return {};
+
+	return it->second.fileBlockData[fileBlock].uncompressedSize;
+}
+
+std::optional<Bundle::EntryDebugInfo> Bundle::GetDebugInfo(const std::string &resourceName) const
+{
+	return GetDebugInfo(HashResourceName(resourceName));
+}
+
+std::optional<Bundle::EntryDebugInfo> Bundle::GetDebugInfo(uint32_t resourceID) const
 {
 	const auto it = m_debugInfoEntries.find(resourceID);
 	if (it == m_debugInfoEntries.end())
@@ -933,6 +1577,15 @@ std::optional<Bundle::ResourceType> Bundle::GetResourceType(uint32_t resourceID)
 	return it->second.info.resourceType;
 }
 
+std::optional<Bundle::EntryInfo> Bundle::GetEntryInfo(uint32_t resourceID) const
+{
+	const auto it = m_entries.find(resourceID);
+	if (it == m_entries.end())
+		return {};
+
+	return it->second.info;
+}
+
 bool Bundle::AddResource(const std::string &resourceName, const EntryData &data, Bundle::ResourceType resourceType)
 {
 	return AddResource(HashResourceName(resourceName), data, resourceType);
@@ -946,6 +1599,7 @@ bool Bundle::AddResource(uint32_t resourceID, const EntryData &data, Bundle::Res
 
 	Entry &e = m_entries[resourceID];
 	e.info.resourceType = resourceType;
+	IndexResource(resourceID);
 
 	return ReplaceResource(resourceID, data);
 }
@@ -975,28 +1629,43 @@ bool Bundle::ReplaceResource(const std::string &resourceName, const EntryData &d
 
 bool Bundle::ReplaceResource(uint32_t resourceID, const EntryData &data)
 {
-	const auto it = m_entries.find(resourceID);
-	if (it == m_entries.end() || data.dependencies.size() > std::numeric_limits<uint16_t>::max())
+	if (m_entries.find(resourceID) == m_entries.end())
+		return false;
+
+	auto prepared = PrepareResource(resourceID, data);
+	if (!prepared)
 		return false;
 
-	Entry &e = it->second;
+	std::vector<PreparedResource> resources;
+	resources.push_back(std::move(*prepared));
+	return ReplaceResources(std::move(resources));
+}
+
+std::optional<Bundle::PreparedResource> Bundle::PrepareResource(uint32_t resourceID, const EntryData &data) const
+{
+	if (data.dependencies.size() > std::numeric_limits<uint16_t>::max())
+		return {};
 
-	e.info.checksum = 0;
-	e.info.dependenciesOffset = 0;
-	e.info.numberOfDependencies = 0;
+	PreparedResource prepared = {};
+	prepared.resourceID = resourceID;
+	prepared.magicVersion = m_magicVersion;
+	prepared.platform = m_platform;
+	prepared.compressed = (m_flags & Compressed) != 0;
+	prepared.info.checksum = HashDependencies(data.dependencies);
+
+	if (m_magicVersion == BNDL)
+	{
+		prepared.dependencies = data.dependencies;
+		prepared.info.numberOfDependencies = static_cast<uint16_t>(data.dependencies.size());
+	}
 
 	for (auto i = 0; i < 3; i++)
 	{
 		const auto &inDataInfo = data.fileBlockData[i];
-		auto &outDataInfo = e.fileBlockData[i];
+		auto &outDataInfo = prepared.fileBlockData[i];
 
 		if (inDataInfo == nullptr || inDataInfo->empty())
-		{
-			outDataInfo.data = nullptr;
-			outDataInfo.uncompressedSize = 0;
-			outDataInfo.compressedSize = 0;
 			continue;
-		}
 
 		std::unique_ptr<std::vector<uint8_t>> inBuffer;
 		std::unique_ptr<std::vector<uint8_t>> outBuffer;
@@ -1004,11 +1673,9 @@ bool Bundle::ReplaceResource(uint32_t resourceID, const EntryData &data)
 		if (m_magicVersion == BND2 && i == 0 && !data.dependencies.empty())
 		{
 			binaryio::BinaryWriter writer;
+			writer.SetBigEndian(m_platform != PC);
 			for (const auto &dependency : data.dependencies)
-			{
 				WriteDependency(writer, dependency);
-				e.info.checksum &= dependency.resourceID;
-			}
 			const auto depSize = writer.GetSize();
 			auto depStream = writer.GetStream();
 
@@ -1019,8 +1686,8 @@ bool Bundle::ReplaceResource(uint32_t resourceID, const EntryData &data)
 			inBuffer->resize(inSize);
 			inBuffer->insert(inBuffer->end(), std::istreambuf_iterator<char>(depStream), std::istreambuf_iterator<char>());
 
-			e.info.dependenciesOffset = static_cast<uint32_t>(inSize);
-			e.info.numberOfDependencies = static_cast<uint16_t>(data.dependencies.size());
+			prepared.info.dependenciesOffset = static_cast<uint32_t>(inSize);
+			prepared.info.numberOfDependencies = static_cast<uint16_t>(data.dependencies.size());
 		}
 		else
 		{
@@ -1031,19 +1698,18 @@ bool Bundle::ReplaceResource(uint32_t resourceID, const EntryData &data)
 
 		if (m_flags & Compressed)
 		{
-			const auto compBufferSize = compressBound(static_cast<uLong>(inBuffer->size()));
-			outBuffer = std::make_unique<std::vector<uint8_t>>(compBufferSize);
-			uLongf actualSize = compBufferSize;
-			const auto ret = compress2(outBuffer->data(), &actualSize, inBuffer->data(), static_cast<uLong>(inBuffer->size()), Z_BEST_COMPRESSION);
+			outBuffer = std::make_unique<std::vector<uint8_t>>(detail::codec::DeflateBound(inBuffer->size()));
+			const auto actualSize = detail::codec::Deflate(inBuffer->data(), inBuffer->size(), outBuffer->data(), outBuffer->size());
 
-			if (ret != Z_OK)
+			if (actualSize == 0)
 			{
 				assert(0);
-				return false;
+				return {};
 			}
 
+			outBuffer->resize(actualSize);
 			outBuffer->shrink_to_fit();
-			outDataInfo.compressedSize = actualSize;
+			outDataInfo.compressedSize = static_cast<uint32_t>(actualSize);
 		}
 		else
 		{
@@ -1056,6 +1722,46 @@ bool Bundle::ReplaceResource(uint32_t resourceID, const EntryData &data)
 		outDataInfo.uncompressedAlignment = data.alignments[i];
 	}
 
+	return prepared;
+}
+
+bool Bundle::ReplaceResources(std::vector<PreparedResource> resources)
+{
+	for (const auto &resource : resources)
+	{
+		if (resource.magicVersion != m_magicVersion || resource.platform != m_platform || resource.compressed != ((m_flags & Compressed) != 0))
+			return false;
+		if (m_entries.find(resource.resourceID) == m_entries.end())
+			return false;
+	}
+
+	for (auto &resource : resources)
+	{
+		Entry &e = m_entries.at(resource.resourceID);
+		DropSeekIndex(resource.resourceID);
+
+		e.info.checksum = resource.info.checksum;
+		e.info.dependenciesOffset = resource.info.dependenciesOffset;
+		e.info.numberOfDependencies = resource.info.numberOfDependencies;
+
+		if (m_magicVersion == BNDL)
+		{
+			if (resource.dependencies.empty())
+				m_dependencies.erase(resource.resourceID);
+			else
+				m_dependencies[resource.resourceID] = std::move(resource.dependencies);
+		}
+
+		for (auto i = 0; i < 3; i++)
+		{
+			// Empty blocks keep the alignment they had.
+			auto &block = resource.fileBlockData[i];
+			if (block.data == nullptr)
+				block.uncompressedAlignment = e.fileBlockData[i].uncompressedAlignment;
+			e.fileBlockData[i] = std::move(block);
+		}
+	}
+
 	return true;
 }
 
@@ -1066,22 +1772,1217 @@ void Bundle::WriteDependency(binaryio::BinaryWriter &writer, const Dependency &d
 	writer.Align(8);
 }
 
-std::vector<uint32_t> Bundle::ListResourceIDs() const
+uint32_t Bundle::HashDependencies(const std::vector<Dependency> &dependencies)
 {
-	std::vector<uint32_t> entries;
-	for (const auto &e : m_entries)
-	{
-		entries.push_back(e.first);
-	}
-	return entries;
+	// The import hash is the bitwise OR of every imported resource ID.
+	uint32_t hash = 0;
+	for (const auto &dependency : dependencies)
+		hash |= dependency.resourceID;
+	return hash;
 }
 
-std::map<Bundle::ResourceType, std::vector<uint32_t>> Bundle::ListResourceIDsByType() const
+std::optional<Bundle::ProbeInfo> Bundle::Probe(const std::string &name)
 {
-	std::map<ResourceType, std::vector<uint32_t>> entriesByResourceType;
-	for (const auto &e : m_entries)
+	std::ifstream stream(name, std::ios::in | std::ios::binary | std::ios::ate);
+	if (stream.fail())
+		return {};
+
+	const auto fileSize = static_cast<uint64_t>(stream.tellg());
+	stream.seekg(0, std::ios::beg);
+
+	// Large enough for the biggest header, a PS3 bndl.
+	const auto buffer = std::make_shared<std::vector<uint8_t>>(std::min<uint64_t>(fileSize, 0x80));
+	stream.read(reinterpret_cast<char *>(buffer->data()), buffer->size());
+	if (stream.fail())
+		return {};
+
+	return ProbeBuffer(buffer, fileSize);
+}
+
+std::optional<Bundle::ProbeInfo> Bundle::Probe(const uint8_t *data, size_t size)
+{
+	if (data == nullptr)
+		return {};
+
+	return ProbeBuffer(std::make_shared<std::vector<uint8_t>>(data, data + std::min<size_t>(size, 0x80)), size);
+}
+
+std::optional<Bundle::ProbeInfo> Bundle::ProbeBuffer(const std::shared_ptr<std::vector<uint8_t>> &buffer, uint64_t fileSize)
+{
+	if (buffer->size() < 0x30)
+		return {};
+
+	auto reader = binaryio::BinaryReader(buffer);
+	const auto magic = reader.ReadString(4);
+
+	ProbeInfo info = {};
+	if (magic == std::string("bnd2"))
+	{
+		BND2Header header;
+		if (!ReadBND2Header(reader, header))
+			return {};
+
+		const auto *offsets = header.fileBlockOffsets;
+		if (offsets[0] > offsets[1] || offsets[1] > offsets[2] || offsets[2] > fileSize)
+			return {};
+
+		// The ID block sits between the header and the first data block, 0x40 bytes per entry.
+		if (header.idBlockOffset > offsets[0] || header.numEntries * 0x40ULL > offsets[0] - header.idBlockOffset)
+			return {};
+
+		info.magicVersion = BND2;
+		info.revisionNumber = header.revisionNumber;
+		info.platform = header.platform;
+		info.flags = header.flags;
+		info.numEntries = header.numEntries;
+		info.blockSizes[0] = offsets[1] - offsets[0];
+		info.blockSizes[1] = offsets[2] - offsets[1];
+		info.blockSizes[2] = static_cast<uint32_t>(fileSize - offsets[2]);
+		return info;
+	}
+
+	if (magic != std::string("bndl") || buffer->size() < 0x68)
+		return {};
+
+	info.magicVersion = BNDL;
+	info.platform = ReadBNDLPlatform(reader);
+	if (info.platform == 0)
+		return {};
+	reader.SetBigEndian(info.platform != PC);
+
+	info.revisionNumber = reader.Read<uint32_t>();
+	if (info.revisionNumber < 3 || info.revisionNumber > 5)
+		return {};
+
+	info.numEntries = reader.Read<uint32_t>();
+
+	auto blocks = 4;
+	if (info.platform == Xbox360)
+		blocks = 5;
+	else if (info.platform == PS3)
+		blocks = 6;
+	for (auto i = 0; i < blocks; i++)
 	{
-		entriesByResourceType[e.second.info.resourceType].push_back(e.first);
+		const auto size = reader.Read<uint32_t>();
+		reader.Skip<uint32_t>(); // Alignment
+
+		const auto mappedBlock = MapBNDLBlockToBND2(info.platform, i);
+		if (mappedBlock != -1)
+			info.blockSizes[mappedBlock] = size;
 	}
-	return entriesByResourceType;
+
+	// Every entry has an 8-byte ID in the ID list and a row in the ID table.
+	const auto tableEntrySize = 0xC + 0x14 * blocks;
+	if (info.numEntries * (8ULL + tableEntrySize) > fileSize)
+		return {};
+
+	info.flags = static_cast<Flags>(0);
+	if (info.revisionNumber >= 4)
+	{
+		reader.Seek(0x4 * blocks + 0x14, std::ios::cur); // memory addresses, block pointers and platform
+		if (reader.GetOffset() + 4 > static_cast<off_t>(buffer->size()))
+			return {};
+
+		if (reader.Read<uint32_t>() != 0)
+			info.flags = Compressed;
+	}
+
+	return info;
+}
+
+std::shared_ptr<std::vector<uint8_t>> Bundle::ReadFileRange(std::istream &stream, uint64_t offset, uint64_t size)
+{
+	stream.seekg(offset, std::ios::beg);
+	const auto buffer = std::make_shared<std::vector<uint8_t>>(size);
+	stream.read(reinterpret_cast<char *>(buffer->data()), size);
+	if (stream.fail())
+		return nullptr;
+
+	return buffer;
+}
+
+std::optional<Bundle::BundleSummary> Bundle::Summarize(const std::string &name)
+{
+	std::ifstream stream(name, std::ios::in | std::ios::binary | std::ios::ate);
+	if (stream.fail())
+		return {};
+
+	const auto fileSize = static_cast<uint64_t>(stream.tellg());
+	const auto headerBuffer = ReadFileRange(stream, 0, std::min<uint64_t>(fileSize, 0x80));
+	if (headerBuffer == nullptr)
+		return {};
+
+	const auto header = ProbeBuffer(headerBuffer, fileSize);
+	if (!header)
+		return {};
+
+	BundleSummary summary;
+	summary.header = *header;
+	summary.resources.reserve(header->numEntries);
+	const auto compressed = (header->flags & Compressed) != 0;
+
+	if (header->magicVersion == BND2)
+	{
+		auto headerReader = binaryio::BinaryReader(headerBuffer);
+		headerReader.Seek(4);
+		BND2Header bnd2Header;
+		ReadBND2Header(headerReader, bnd2Header);
+
+		const auto idBlock = ReadFileRange(stream, bnd2Header.idBlockOffset, header->numEntries * 0x40ULL);
+		if (idBlock == nullptr)
+			return {};
+
+		auto reader = binaryio::BinaryReader(idBlock, header->platform != PC);
+		for (auto i = 0U; i < header->numEntries; i++)
+		{
+			ResourceSummary resource;
+			resource.resourceID = static_cast<uint32_t>(reader.Read<uint64_t>());
+			reader.Skip<uint64_t>(); // import hash
+			for (auto &size : resource.uncompressedSizes)
+				size = reader.Read<uint32_t>() & ~(0xFU << 28);
+			for (auto &size : resource.compressedSizes)
+				size = reader.Read<uint32_t>();
+			reader.Seek(0xC + 4, std::ios::cur); // offsets, imports offset
+			resource.resourceType = reader.Read<ResourceType>();
+			reader.Seek(4, std::ios::cur); // number of imports, padding
+			summary.resources.push_back(resource);
+		}
+
+		return summary;
+	}
+
+	// BNDL
+	auto blocks = 4;
+	if (header->platform == Xbox360)
+		blocks = 5;
+	else if (header->platform == PS3)
+		blocks = 6;
+
+	auto headerReader = binaryio::BinaryReader(headerBuffer, header->platform != PC);
+	headerReader.Seek(0xC + 0xC * blocks);
+	const auto idListOffset = headerReader.Read<uint32_t>();
+	const auto idTableOffset = headerReader.Read<uint32_t>();
+	auto uncompInfoOffset = 0U;
+	if (header->revisionNumber >= 4)
+	{
+		headerReader.Seek(0x10, std::ios::cur); // import block, data block, platform, compressed
+		headerReader.Skip<uint32_t>(); // number of compressed resources
+		uncompInfoOffset = headerReader.Read<uint32_t>();
+	}
+
+	const auto tableEntrySize = 0xC + 0x14 * blocks;
+	const auto idList = ReadFileRange(stream, idListOffset, header->numEntries * 8ULL);
+	const auto idTable = ReadFileRange(stream, idTableOffset, static_cast<uint64_t>(header->numEntries) * tableEntrySize);
+	const auto uncompInfo = compressed ? ReadFileRange(stream, uncompInfoOffset, header->numEntries * 8ULL * blocks) : nullptr;
+	if (idList == nullptr || idTable == nullptr || (compressed && uncompInfo == nullptr))
+		return {};
+
+	auto idReader = binaryio::BinaryReader(idList, header->platform != PC);
+	auto tableReader = binaryio::BinaryReader(idTable, header->platform != PC);
+	for (auto i = 0U; i < header->numEntries; i++)
+	{
+		ResourceSummary resource = {};
+		resource.resourceID = static_cast<uint32_t>(idReader.Read<uint64_t>());
+
+		tableReader.Seek(i * tableEntrySize + 8);
+		resource.resourceType = tableReader.Read<ResourceType>();
+		for (auto j = 0; j < blocks; j++)
+		{
+			const auto size = tableReader.Read<uint32_t>();
+			tableReader.Skip<uint32_t>(); // alignment
+
+			const auto mappedBlock = MapBNDLBlockToBND2(header->platform, j);
+			if (mappedBlock == -1)
+				continue;
+
+			if (compressed)
+				resource.compressedSizes[mappedBlock] = size;
+			else
+				resource.uncompressedSizes[mappedBlock] = size;
+		}
+
+		if (compressed)
+		{
+			auto uncompReader = binaryio::BinaryReader(uncompInfo, header->platform != PC);
+			uncompReader.Seek(i * 8 * blocks);
+			for (auto j = 0; j < blocks; j++)
+			{
+				const auto size = uncompReader.Read<uint32_t>();
+				uncompReader.Skip<uint32_t>(); // alignment
+
+				const auto mappedBlock = MapBNDLBlockToBND2(header->platform, j);
+				if (mappedBlock != -1)
+					resource.uncompressedSizes[mappedBlock] = size;
+			}
+		}
+
+		if (resource.resourceID != 0xC039284A) // ResourceStringTable, not a resource
+			summary.resources.push_back(resource);
+	}
+
+	summary.header.numEntries = static_cast<uint32_t>(summary.resources.size());
+	return summary;
+}
+
+std::optional<std::map<uint32_t, Bundle::EntryDebugInfo>> Bundle::ReadDebugInfo(const std::string &name)
+{
+	std::ifstream stream(name, std::ios::in | std::ios::binary | std::ios::ate);
+	if (stream.fail())
+		return {};
+
+	const auto fileSize = static_cast<uint64_t>(stream.tellg());
+	const auto headerBuffer = ReadFileRange(stream, 0, std::min<uint64_t>(fileSize, 0x80));
+	if (headerBuffer == nullptr)
+		return {};
+
+	const auto header = ProbeBuffer(headerBuffer, fileSize);
+	if (!header)
+		return {};
+
+	std::map<uint32_t, EntryDebugInfo> debugInfoEntries;
+	if (header->magicVersion == BND2)
+	{
+		if ((header->flags & HasResourceStringTable) == 0)
+			return debugInfoEntries;
+
+		auto headerReader = binaryio::BinaryReader(headerBuffer);
+		headerReader.Seek(4);
+		BND2Header bnd2Header;
+		ReadBND2Header(headerReader, bnd2Header);
+
+		// The table is written between the header and the ID block.
+		if (bnd2Header.rstOffset > bnd2Header.idBlockOffset)
+			return {};
+
+		const auto rst = ReadFileRange(stream, bnd2Header.rstOffset, bnd2Header.idBlockOffset - bnd2Header.rstOffset);
+		if (rst == nullptr)
+			return {};
+
+		const auto end = std::find(rst->begin(), rst->end(), 0);
+		ParseResourceStringTable(std::string(rst->begin(), end), debugInfoEntries);
+		return debugInfoEntries;
+	}
+
+	// BNDL keeps the table as a resource, so only its row and its block 0 are read.
+	auto blocks = 4;
+	if (header->platform == Xbox360)
+		blocks = 5;
+	else if (header->platform == PS3)
+		blocks = 6;
+
+	auto headerReader = binaryio::BinaryReader(headerBuffer, header->platform != PC);
+	headerReader.Seek(0xC + 0xC * blocks);
+	const auto idListOffset = headerReader.Read<uint32_t>();
+	const auto idTableOffset = headerReader.Read<uint32_t>();
+	auto uncompInfoOffset = 0U;
+	if (header->revisionNumber >= 4)
+	{
+		headerReader.Seek(0x10, std::ios::cur); // import block, data block, platform, compressed
+		headerReader.Skip<uint32_t>(); // number of compressed resources
+		uncompInfoOffset = headerReader.Read<uint32_t>();
+	}
+
+	const auto idList = ReadFileRange(stream, idListOffset, header->numEntries * 8ULL);
+	if (idList == nullptr)
+		return {};
+
+	auto idReader = binaryio::BinaryReader(idList, header->platform != PC);
+	auto index = 0U;
+	while (index < header->numEntries && static_cast<uint32_t>(idReader.Read<uint64_t>()) != 0xC039284A)
+		index++;
+	if (index == header->numEntries)
+		return debugInfoEntries;
+
+	const auto tableEntrySize = 0xC + 0x14 * blocks;
+	const auto row = ReadFileRange(stream, idTableOffset + static_cast<uint64_t>(index) * tableEntrySize, tableEntrySize);
+	if (row == nullptr)
+		return {};
+
+	auto rowReader = binaryio::BinaryReader(row, header->platform != PC);
+	rowReader.Seek(0xC);
+	const auto size = rowReader.Read<uint32_t>(); // compressed size if compressed
+	rowReader.Seek(0xC + 0x8 * blocks);
+	const auto offset = rowReader.Read<uint32_t>(); // block 0 starts the data block
+
+	auto rstFile = ReadFileRange(stream, offset, size);
+	if (rstFile == nullptr)
+		return {};
+
+	if ((header->flags & Compressed) != 0)
+	{
+		const auto uncompInfo = ReadFileRange(stream, uncompInfoOffset + index * 8ULL * blocks, 4);
+		if (uncompInfo == nullptr)
+			return {};
+
+		const auto uncompressedSize = binaryio::BinaryReader(uncompInfo, header->platform != PC).Read<uint32_t>();
+		auto uncompressed = std::make_shared<std::vector<uint8_t>>(uncompressedSize);
+		if (!detail::codec::Inflate(rstFile->data(), rstFile->size(), uncompressed->data(), uncompressed->size()))
+			return {};
+		rstFile = std::move(uncompressed);
+	}
+
+	ParseResourceStringTable(ReadBNDLResourceStringTable(std::move(rstFile)), debugInfoEntries);
+	return debugInfoEntries;
+}
+
+std::string Bundle::ReadBNDLResourceStringTable(std::shared_ptr<std::vector<uint8_t>> rstFile)
+{
+	auto rstReader = binaryio::BinaryReader(std::move(rstFile));
+
+	const auto strLen = rstReader.Read<uint32_t>();
+	auto rstXML = rstReader.ReadString(strLen);
+
+	// Cover Criterion's broken XML writer.
+	if (rstXML.rfind("</ResourceStringTable>", 0) == 0)
+		rstXML.erase(1, 1);
+	const auto pos = rstXML.find("</ResourceStringTable>\n\t");
+	if (pos != std::string::npos)
+		rstXML.erase(pos, 23);
+
+	return rstXML;
+}
+
+void Bundle::ParseResourceStringTable(const std::string &rstXML, std::map<uint32_t, EntryDebugInfo> &debugInfoEntries)
+{
+	pugi::xml_document doc;
+	if (!doc.load_string(rstXML.c_str(), pugi::parse_minimal))
+		return;
+
+	for (const auto resource : doc.child("ResourceStringTable").children("Resource"))
+	{
+		const auto resourceID = std::stoul(resource.attribute("id").value(), nullptr, 16);
+		auto &debugInfo = debugInfoEntries[resourceID];
+		debugInfo.name = resource.attribute("name").value();
+		debugInfo.typeName = resource.attribute("type").value();
+	}
+}
+
+std::vector<Bundle::VerifyIssue> Bundle::Verify(const std::string &name)
+{
+	std::vector<VerifyIssue> issues;
+
+	// Blocks are checked straight from the mapping. Only the tables in front of them are copied to be parsed.
+	detail::MappedFile file;
+	if (!file.Open(name) || file.GetSize() < 4)
+	{
+		issues.push_back({ 0, "Could not read the file" });
+		return issues;
+	}
+
+	const auto fileSize = static_cast<uint64_t>(file.GetSize());
+	const auto headerBuffer = std::make_shared<std::vector<uint8_t>>(file.GetData(), file.GetData() + std::min<uint64_t>(fileSize, 0x80));
+	auto tablesSize = fileSize;
+	if (std::memcmp(file.GetData(), "bnd2", 4) == 0)
+	{
+		auto reader = binaryio::BinaryReader(headerBuffer);
+		reader.Seek(4);
+		BND2Header header;
+		if (fileSize >= 0x30 && ReadBND2Header(reader, header))
+			tablesSize = std::min<uint64_t>(fileSize, header.fileBlockOffsets[0]);
+	}
+	else if (const auto header = ProbeBuffer(headerBuffer, fileSize); header && header->magicVersion == BNDL)
+	{
+		auto blocks = 4;
+		if (header->platform == Xbox360)
+			blocks = 5;
+		else if (header->platform == PS3)
+			blocks = 6;
+
+		auto reader = binaryio::BinaryReader(headerBuffer, header->platform != PC);
+		reader.Seek(0xC + 0xC * blocks + 0xC); // ID list, ID table, import block
+		tablesSize = std::min<uint64_t>(fileSize, reader.Read<uint32_t>());
+	}
+	else
+	{
+		issues.push_back({ 0, "Not a supported bundle" });
+		return issues;
+	}
+
+	const auto tables = std::make_shared<std::vector<uint8_t>>(file.GetData(), file.GetData() + tablesSize);
+	if (std::memcmp(file.GetData(), "bnd2", 4) == 0)
+	{
+		VerifyBND2(tables, fileSize, issues);
+		if (!issues.empty())
+			return issues;
+	}
+
+	Bundle bundle;
+	BlockOffsets blockOffsets;
+	try
+	{
+		if (!bundle.LoadBuffer(tables, &blockOffsets, nullptr, false))
+			issues.push_back({ 0, "Not a supported bundle" });
+	}
+	catch (const std::exception &e)
+	{
+		issues.push_back({ 0, std::string("Failed to read the bundle: ") + e.what() });
+	}
+
+	if (issues.empty())
+		bundle.VerifyEntries(file.GetData(), fileSize, blockOffsets, issues);
+
+	return issues;
+}
+
+void Bundle::VerifyBND2(const std::shared_ptr<std::vector<uint8_t>> &tables, uint64_t fileSize, std::vector<VerifyIssue> &issues)
+{
+	const auto tablesSize = static_cast<uint64_t>(tables->size());
+	constexpr auto headerSize = 0x30U;
+	constexpr auto idEntrySize = 0x40U;
+
+	BND2Header header;
+	auto reader = binaryio::BinaryReader(tables);
+	reader.Seek(4);
+	if (tablesSize < headerSize || !ReadBND2Header(reader, header))
+	{
+		issues.push_back({ 0, "Invalid header" });
+		return;
+	}
+
+	// The string table and the ID block come before the first file block.
+	if (header.platform != PC && header.platform != Xbox360 && header.platform != PS3)
+		issues.push_back({ 0, "Unknown platform" });
+	if ((header.flags & HasResourceStringTable) && (header.rstOffset < headerSize || header.rstOffset >= tablesSize))
+		issues.push_back({ 0, "Resource string table is out of bounds" });
+	if (header.idBlockOffset < headerSize || header.idBlockOffset + static_cast<uint64_t>(header.numEntries) * idEntrySize > tablesSize)
+		issues.push_back({ 0, "ID block is out of bounds" });
+
+	uint64_t blockEnds[3];
+	for (auto i = 0; i < 3; i++)
+	{
+		blockEnds[i] = (i < 2) ? header.fileBlockOffsets[i + 1] : fileSize;
+		if (header.fileBlockOffsets[i] > blockEnds[i] || blockEnds[i] > fileSize)
+			issues.push_back({ 0, "File block " + std::to_string(i) + " is out of bounds" });
+	}
+
+	if (!issues.empty())
+		return;
+
+	// Everything the ID block points at must lie within the file block it belongs to.
+	std::map<uint32_t, uint32_t> seenIDs;
+	reader.Seek(header.idBlockOffset);
+	for (auto i = 0U; i < header.numEntries; i++)
+	{
+		const auto resourceID = static_cast<uint32_t>(reader.Read<uint64_t>());
+		reader.Skip<uint64_t>(); // import hash
+
+		if (resourceID == 0)
+			issues.push_back({ 0, "Entry " + std::to_string(i) + " has no resource ID" });
+		else if (seenIDs[resourceID]++ == 1)
+			issues.push_back({ resourceID, "Resource is stored more than once" });
+
+		uint32_t uncompressedSizes[3];
+		for (auto &size : uncompressedSizes)
+			size = reader.Read<uint32_t>() & ~(0xFU << 28);
+		uint32_t compressedSizes[3];
+		for (auto &size : compressedSizes)
+			size = reader.Read<uint32_t>();
+
+		for (auto j = 0; j < 3; j++)
+		{
+			const auto offset = header.fileBlockOffsets[j] + static_cast<uint64_t>(reader.Read<uint32_t>());
+			const auto size = (header.flags & Compressed) ? compressedSizes[j] : uncompressedSizes[j];
+			if (size > 0 && offset + size > blockEnds[j])
+				issues.push_back({ resourceID, "Block " + std::to_string(j) + " is out of bounds" });
+		}
+
+		const auto dependenciesOffset = reader.Read<uint32_t>();
+		reader.Skip<uint32_t>(); // resource type
+		const auto numberOfDependencies = reader.Read<uint16_t>();
+		reader.Skip<uint16_t>(); // padding
+
+		if (numberOfDependencies > 0 && dependenciesOffset + numberOfDependencies * 16ULL > uncompressedSizes[0])
+			issues.push_back({ resourceID, "Import table is out of bounds" });
+	}
+}
+
+void Bundle::VerifyEntries(const uint8_t *file, uint64_t fileSize, const BlockOffsets &blockOffsets, std::vector<VerifyIssue> &issues) const
+{
+	const auto resourceIDs = ListResourceIDs();
+	std::vector<std::vector<VerifyIssue>> entryIssues(resourceIDs.size());
+
+	detail::ParallelFor(resourceIDs.size(), [&](size_t i)
+	{
+		const auto resourceID = resourceIDs[i];
+		const auto &e = m_entries.at(resourceID);
+		const auto &offsets = blockOffsets.at(resourceID);
+		auto &out = entryIssues[i];
+
+		for (auto j = 0; j < 3; j++)
+		{
+			const auto &dataInfo = e.fileBlockData[j];
+			if (dataInfo.uncompressedSize == 0)
+				continue;
+
+			const auto block = std::to_string(j);
+			const auto storedSize = (m_flags & Compressed) ? dataInfo.compressedSize : dataInfo.uncompressedSize;
+			if (storedSize == 0)
+				out.push_back({ resourceID, "Block " + block + " has no data" });
+			else if (offsets[j] + storedSize > fileSize)
+				out.push_back({ resourceID, "Block " + block + " is out of bounds" });
+			else if ((m_flags & Compressed) && !IsZlibStreamValid(file + offsets[j], dataInfo.compressedSize, dataInfo.uncompressedSize))
+				out.push_back({ resourceID, "Block " + block + " does not inflate to its uncompressed size" });
+		}
+
+		// Reading the imports needs an intact block 0.
+		if (!out.empty())
+			return;
+
+		std::optional<std::vector<Dependency>> dependencies;
+		if (m_magicVersion == BNDL || e.info.numberOfDependencies == 0)
+		{
+			dependencies = GetDependencies(resourceID);
+		}
+		else if (e.info.dependenciesOffset <= e.fileBlockData[0].uncompressedSize)
+		{
+			// Only as much of block 0 as ends with the import table is read.
+			const auto &dataInfo = e.fileBlockData[0];
+			const auto tableEnd = std::min<uint64_t>(e.info.dependenciesOffset + e.info.numberOfDependencies * 16ULL, dataInfo.uncompressedSize);
+			auto table = std::make_shared<std::vector<uint8_t>>();
+			if (dataInfo.compressedSize > 0)
+			{
+				std::vector<uint8_t> prefix(tableEnd);
+				prefix.resize(detail::codec::InflatePrefix(file + offsets[0], dataInfo.compressedSize, prefix.data(), prefix.size()));
+				if (prefix.size() > e.info.dependenciesOffset)
+					table->assign(prefix.begin() + e.info.dependenciesOffset, prefix.end());
+			}
+			else
+			{
+				table->assign(file + offsets[0] + e.info.dependenciesOffset, file + offsets[0] + tableEnd);
+			}
+			dependencies = ReadDependencyTable(table, e.info.numberOfDependencies, m_platform != PC);
+		}
+
+		if (!dependencies || dependencies->size() != e.info.numberOfDependencies)
+		{
+			out.push_back({ resourceID, "Import table is unreadable" });
+			return;
+		}
+
+		const auto importsEnd = (m_magicVersion == BND2) ? e.info.dependenciesOffset : e.fileBlockData[0].uncompressedSize;
+		for (const auto &dependency : *dependencies)
+		{
+			if (dependency.resourceID == 0)
+				out.push_back({ resourceID, "Import has no resource ID" });
+			if (dependency.internalOffset + 4ULL > importsEnd)
+				out.push_back({ resourceID, "Import offset is out of bounds" });
+		}
+
+		if (m_magicVersion == BND2 && e.info.checksum != HashDependencies(*dependencies))
+			out.push_back({ resourceID, "Import hash does not match the imports" });
+	});
+
+	for (auto &resourceIssues : entryIssues)
+		issues.insert(issues.end(), resourceIssues.begin(), resourceIssues.end());
+}
+
+bool Bundle::ConvertPlatform(Platform platform)
+{
+	if (platform != PC && platform != Xbox360 && platform != PS3)
+		return false;
+
+	const auto swap = (platform != PC) != (m_platform != PC);
+
+	// BNDL imports live in m_dependencies and the ID tables are swapped by the writer on save.
+	if (!swap || m_magicVersion != BND2)
+	{
+		m_platform = platform;
+		return true;
+	}
+
+	std::vector<uint32_t> resourceIDs;
+	std::vector<EntryFileBlockData *> blocks;
+	std::vector<uint16_t> numDependencies;
+	std::vector<uint32_t> dependencyOffsets;
+	for (auto &entry : m_entries)
+	{
+		const auto &info = entry.second.info;
+		auto &dataInfo = entry.second.fileBlockData[0];
+		if (info.numberOfDependencies == 0 || dataInfo.data == nullptr)
+			continue;
+
+		if (info.dependenciesOffset + info.numberOfDependencies * 16ULL > dataInfo.uncompressedSize)
+			return false;
+
+		resourceIDs.push_back(entry.first);
+		blocks.push_back(&dataInfo);
+		numDependencies.push_back(info.numberOfDependencies);
+		dependencyOffsets.push_back(info.dependenciesOffset);
+	}
+
+	// Swapped blocks are only committed once every entry converted successfully.
+	std::vector<std::unique_ptr<std::vector<uint8_t>>> converted(blocks.size());
+	std::atomic<bool> success = true;
+	detail::ParallelFor(blocks.size(), [&](size_t i)
+	{
+		const auto &dataInfo = *blocks[i];
+		if (dataInfo.compressedSize == 0)
+		{
+			converted[i] = std::make_unique<std::vector<uint8_t>>(*dataInfo.data);
+			detail::SwapDependencyTable(converted[i]->data() + dependencyOffsets[i], numDependencies[i]);
+			return;
+		}
+
+		std::vector<uint8_t> block(dataInfo.uncompressedSize);
+		if (!detail::codec::Inflate(dataInfo.data->data(), dataInfo.compressedSize, block.data(), block.size()))
+		{
+			success = false;
+			return;
+		}
+
+		detail::SwapDependencyTable(block.data() + dependencyOffsets[i], numDependencies[i]);
+
+		converted[i] = std::make_unique<std::vector<uint8_t>>(detail::codec::DeflateBound(block.size()));
+		const auto compressedSize = detail::codec::Deflate(block.data(), block.size(), converted[i]->data(), converted[i]->size());
+		if (compressedSize == 0)
+		{
+			success = false;
+			return;
+		}
+
+		converted[i]->resize(compressedSize);
+	});
+
+	if (!success)
+		return false;
+
+	for (auto i = 0U; i < blocks.size(); i++)
+	{
+		auto &dataInfo = *blocks[i];
+		if (dataInfo.compressedSize > 0)
+			dataInfo.compressedSize = static_cast<uint32_t>(converted[i]->size());
+		dataInfo.data = std::move(converted[i]);
+		m_seekIndex.erase({ resourceIDs[i], 0 });
+	}
+
+	m_platform = platform;
+	return true;
+}
+
+bool Bundle::HasSameStorage(const Bundle &other) const
+{
+	return m_magicVersion == other.m_magicVersion && m_platform == other.m_platform && (m_flags & Compressed) == (other.m_flags & Compressed);
+}
+
+bool Bundle::CopyResourceFrom(const Bundle &source, const std::string &resourceName)
+{
+	return CopyResourceFrom(source, HashResourceName(resourceName));
+}
+
+bool Bundle::CopyResourceFrom(const Bundle &source, uint32_t resourceID)
+{
+	// The resource is either there already or not in the source.
+	if (&source == this)
+		return false;
+
+	const auto sourceIt = source.m_entries.find(resourceID);
+	if (sourceIt == source.m_entries.end() || m_entries.count(resourceID))
+		return false;
+
+	if (HasSameStorage(source))
+	{
+		m_entries[resourceID] = sourceIt->second;
+		IndexResource(resourceID);
+
+		const auto dependencies = source.m_dependencies.find(resourceID);
+		if (dependencies != source.m_dependencies.end())
+			m_dependencies[resourceID] = dependencies->second;
+	}
+	else
+	{
+		const auto data = source.GetData(resourceID);
+		if (!data || !AddResource(resourceID, *data, sourceIt->second.info.resourceType))
+			return false;
+	}
+
+	const auto debugInfo = source.m_debugInfoEntries.find(resourceID);
+	if (debugInfo != source.m_debugInfoEntries.end())
+		m_debugInfoEntries.emplace(resourceID, debugInfo->second);
+
+	return true;
+}
+
+bool Bundle::Merge(const Bundle &source, bool replaceExisting)
+{
+	// Replacing would erase the entries being walked.
+	if (&source == this)
+		return true;
+
+	auto success = true;
+	for (const auto &entry : source.m_entries)
+	{
+		const auto resourceID = entry.first;
+		if (m_entries.count(resourceID))
+		{
+			if (!replaceExisting)
+				continue;
+
+			UnindexResource(resourceID);
+			m_entries.erase(resourceID);
+			m_dependencies.erase(resourceID);
+			m_debugInfoEntries.erase(resourceID);
+			DropSeekIndex(resourceID);
+		}
+
+		success &= CopyResourceFrom(source, resourceID);
+	}
+
+	return success;
+}
+
+Bundle Bundle::Split(const std::vector<uint32_t> &resourceIDs)
+{
+	Bundle split(m_magicVersion, m_revisionNumber, m_platform, m_flags);
+
+	for (const auto resourceID : resourceIDs)
+	{
+		if (m_entries.count(resourceID))
+			UnindexResource(resourceID);
+		auto entry = m_entries.extract(resourceID);
+		if (entry.empty())
+			continue;
+		split.m_entries.insert(std::move(entry));
+		DropSeekIndex(resourceID);
+
+		auto dependencies = m_dependencies.extract(resourceID);
+		if (!dependencies.empty())
+			split.m_dependencies.insert(std::move(dependencies));
+
+		auto debugInfo = m_debugInfoEntries.extract(resourceID);
+		if (!debugInfo.empty())
+			split.m_debugInfoEntries.insert(std::move(debugInfo));
+	}
+
+	split.RebuildTypeIndex();
+	return split;
+}
+
+bool Bundle::IsResourceEqual(uint32_t resourceID, const Bundle &other) const
+{
+	const auto &e = m_entries.at(resourceID);
+	const auto &otherE = other.m_entries.at(resourceID);
+
+	if (e.info.resourceType != otherE.info.resourceType || e.info.numberOfDependencies != otherE.info.numberOfDependencies)
+		return false;
+
+	// In BNDL this is where the import table happened to be in the file.
+	if (m_magicVersion == BND2 && e.info.dependenciesOffset != otherE.info.dependenciesOffset)
+		return false;
+
+	if (m_magicVersion == BNDL && e.info.numberOfDependencies > 0)
+	{
+		const auto &dependencies = m_dependencies.at(resourceID);
+		const auto &otherDependencies = other.m_dependencies.at(resourceID);
+		const auto isSameDependency = [](const Dependency &a, const Dependency &b)
+		{
+			return a.resourceID == b.resourceID && a.internalOffset == b.internalOffset;
+		};
+		if (!std::equal(dependencies.begin(), dependencies.end(), otherDependencies.begin(), otherDependencies.end(), isSameDependency))
+			return false;
+	}
+
+	for (auto i = 0U; i < 3; i++)
+	{
+		const auto &dataInfo = e.fileBlockData[i];
+		const auto &otherDataInfo = otherE.fileBlockData[i];
+
+		if (dataInfo.uncompressedSize != otherDataInfo.uncompressedSize)
+			return false;
+		if (dataInfo.uncompressedSize == 0)
+			continue;
+		if (dataInfo.uncompressedAlignment != otherDataInfo.uncompressedAlignment)
+			return false;
+
+		// Identical stored bytes mean identical contents, whatever the compression.
+		if (dataInfo.data == nullptr || otherDataInfo.data == nullptr)
+			return false;
+		if (dataInfo.compressedSize == otherDataInfo.compressedSize && *dataInfo.data == *otherDataInfo.data)
+			continue;
+
+		// Only uncompressed data is left to compare. Stored bytes differ, but the same data may
+		// have been compressed differently.
+		if (dataInfo.compressedSize == 0 && otherDataInfo.compressedSize == 0)
+			return false;
+		// A block that does not inflate is reported as changed rather than compared.
+		const auto block = ReadBlock(resourceID, i);
+		const auto otherBlock = other.ReadBlock(resourceID, i);
+		if (block == nullptr || otherBlock == nullptr || *block != *otherBlock)
+			return false;
+	}
+
+	return true;
+}
+
+Bundle::Patch Bundle::Diff(const Bundle &newer) const
+{
+	Patch patch;
+	patch.magicVersion = newer.m_magicVersion;
+	patch.platform = newer.m_platform;
+	patch.compressed = (newer.m_flags & Compressed) != 0;
+
+	std::vector<uint32_t> common;
+	for (const auto &entry : m_entries)
+	{
+		if (newer.m_entries.count(entry.first))
+			common.push_back(entry.first);
+		else
+			patch.removed.push_back(entry.first);
+	}
+
+	for (const auto &entry : newer.m_entries)
+	{
+		if (!m_entries.count(entry.first))
+			patch.added.push_back(entry.first);
+	}
+
+	const auto comparable = m_magicVersion == newer.m_magicVersion && m_platform == newer.m_platform;
+	std::vector<uint8_t> changed(common.size());
+	detail::ParallelFor(common.size(), [&](size_t i)
+	{
+		const auto resourceID = common[i];
+		const auto debugInfo = GetDebugInfo(resourceID);
+		const auto newerDebugInfo = newer.GetDebugInfo(resourceID);
+		const auto debugInfoChanged = debugInfo.has_value() != newerDebugInfo.has_value()
+			|| (debugInfo && (debugInfo->name != newerDebugInfo->name || debugInfo->typeName != newerDebugInfo->typeName));
+
+		changed[i] = !comparable || debugInfoChanged || !IsResourceEqual(resourceID, newer);
+	});
+
+	for (auto i = 0U; i < common.size(); i++)
+	{
+		if (changed[i])
+			patch.changed.push_back(common[i]);
+	}
+
+	for (const auto &resourceIDs : { &patch.added, &patch.changed })
+	{
+		for (const auto resourceID : *resourceIDs)
+		{
+			patch.entries[resourceID] = newer.m_entries.at(resourceID);
+
+			const auto dependencies = newer.m_dependencies.find(resourceID);
+			if (dependencies != newer.m_dependencies.end())
+				patch.dependencies[resourceID] = dependencies->second;
+
+			const auto debugInfo = newer.m_debugInfoEntries.find(resourceID);
+			if (debugInfo != newer.m_debugInfoEntries.end())
+				patch.debugInfo[resourceID] = debugInfo->second;
+		}
+	}
+
+	return patch;
+}
+
+bool Bundle::ApplyPatch(const Patch &patch)
+{
+	if (patch.magicVersion != m_magicVersion || patch.platform != m_platform || patch.compressed != ((m_flags & Compressed) != 0))
+		return false;
+
+	for (const auto resourceID : patch.removed)
+	{
+		if (!m_entries.count(resourceID))
+			return false;
+	}
+	for (const auto resourceID : patch.added)
+	{
+		if (m_entries.count(resourceID) || !patch.entries.count(resourceID))
+			return false;
+	}
+	for (const auto resourceID : patch.changed)
+	{
+		if (!m_entries.count(resourceID) || !patch.entries.count(resourceID))
+			return false;
+	}
+
+	for (const auto resourceID : patch.removed)
+	{
+		UnindexResource(resourceID);
+		m_entries.erase(resourceID);
+		m_dependencies.erase(resourceID);
+		m_debugInfoEntries.erase(resourceID);
+		DropSeekIndex(resourceID);
+	}
+
+	for (const auto &resourceIDs : { &patch.added, &patch.changed })
+	{
+		for (const auto resourceID : *resourceIDs)
+		{
+			if (m_entries.count(resourceID))
+				UnindexResource(resourceID);
+			m_entries[resourceID] = patch.entries.at(resourceID);
+			IndexResource(resourceID);
+			DropSeekIndex(resourceID);
+
+			const auto dependencies = patch.dependencies.find(resourceID);
+			if (dependencies != patch.dependencies.end())
+				m_dependencies[resourceID] = dependencies->second;
+			else
+				m_dependencies.erase(resourceID);
+
+			const auto debugInfo = patch.debugInfo.find(resourceID);
+			if (debugInfo != patch.debugInfo.end())
+				m_debugInfoEntries[resourceID] = debugInfo->second;
+			else
+				m_debugInfoEntries.erase(resourceID);
+		}
+	}
+
+	return true;
+}
+
+bool Bundle::SavePatch(const Patch &patch, const std::string &name)
+{
+	auto writer = binaryio::BinaryWriter();
+	writer.Write("bndp", 4);
+	writer.Write<uint32_t>(PatchVersion);
+	writer.Write<uint32_t>(patch.magicVersion);
+	writer.Write<uint32_t>(patch.platform);
+	writer.Write<uint32_t>(patch.compressed);
+
+	writer.Write(static_cast<uint32_t>(patch.removed.size()));
+	for (const auto resourceID : patch.removed)
+		writer.Write(resourceID);
+
+	const auto writeString = [&writer](const std::string &value)
+	{
+		writer.Write(static_cast<uint32_t>(value.size()));
+		writer.Write(value);
+	};
+
+	writer.Write(static_cast<uint32_t>(patch.added.size() + patch.changed.size()));
+	for (const auto &resourceIDs : { &patch.added, &patch.changed })
+	{
+		for (const auto resourceID : *resourceIDs)
+		{
+			const auto entry = patch.entries.find(resourceID);
+			if (entry == patch.entries.end())
+				return false;
+
+			const auto &e = entry->second;
+			writer.Write(resourceID);
+			writer.Write<uint8_t>(resourceIDs == &patch.added);
+			writer.Write(e.info.checksum);
+			writer.Write(e.info.dependenciesOffset);
+			writer.Write(e.info.resourceType);
+			writer.Write(e.info.numberOfDependencies);
+
+			for (const auto &dataInfo : e.fileBlockData)
+			{
+				const auto storedSize = dataInfo.data != nullptr ? static_cast<uint32_t>(dataInfo.data->size()) : 0U;
+				writer.Write(dataInfo.uncompressedSize);
+				writer.Write(dataInfo.uncompressedAlignment);
+				writer.Write(dataInfo.compressedSize);
+				writer.Write(storedSize);
+				if (storedSize > 0)
+					writer.Write(dataInfo.data->data(), storedSize);
+			}
+
+			const auto dependencies = patch.dependencies.find(resourceID);
+			writer.Write(static_cast<uint32_t>(dependencies != patch.dependencies.end() ? dependencies->second.size() : 0));
+			if (dependencies != patch.dependencies.end())
+			{
+				for (const auto &dependency : dependencies->second)
+				{
+					writer.Write(dependency.resourceID);
+					writer.Write(dependency.internalOffset);
+				}
+			}
+
+			const auto debugInfo = patch.debugInfo.find(resourceID);
+			writer.Write<uint8_t>(debugInfo != patch.debugInfo.end());
+			if (debugInfo != patch.debugInfo.end())
+			{
+				writeString(debugInfo->second.name);
+				writeString(debugInfo->second.typeName);
+			}
+		}
+	}
+
+	std::ofstream f(name, std::ios::out | std::ios::binary);
+	f << writer.GetStream().rdbuf();
+	f.close();
+
+	return !f.fail();
+}
+
+std::optional<Bundle::Patch> Bundle::LoadPatch(const std::string &name)
+{
+	const auto buffer = ReadFile(name);
+	if (buffer == nullptr || buffer->size() < 24 || std::memcmp(buffer->data(), "bndp", 4) != 0)
+		return {};
+
+	auto reader = binaryio::BinaryReader(buffer);
+	const auto available = [&reader, &buffer](uint64_t size)
+	{
+		return buffer->size() - reader.GetOffset() >= size;
+	};
+
+	reader.Skip<uint32_t>();
+	if (reader.Read<uint32_t>() != PatchVersion)
+		return {};
+
+	Patch patch;
+	patch.magicVersion = static_cast<MagicVersion>(reader.Read<uint32_t>());
+	patch.platform = static_cast<Platform>(reader.Read<uint32_t>());
+	patch.compressed = reader.Read<uint32_t>() != 0;
+
+	const auto removedCount = reader.Read<uint32_t>();
+	if (!available(uint64_t(removedCount) * 4 + 4))
+		return {};
+	for (auto i = 0U; i < removedCount; i++)
+		patch.removed.push_back(reader.Read<uint32_t>());
+
+	const auto readString = [&reader, &available](std::string &value)
+	{
+		if (!available(4))
+			return false;
+		const auto size = reader.Read<uint32_t>();
+		if (!available(size))
+			return false;
+		value = reader.ReadString(size);
+		return true;
+	};
+
+	const auto entryCount = reader.Read<uint32_t>();
+	for (auto i = 0U; i < entryCount; i++)
+	{
+		if (!available(19))
+			return {};
+
+		const auto resourceID = reader.Read<uint32_t>();
+		const auto added = reader.Read<uint8_t>() != 0;
+		Entry e;
+		e.info.checksum = reader.Read<uint32_t>();
+		e.info.dependenciesOffset = reader.Read<uint32_t>();
+		e.info.resourceType = reader.Read<ResourceType>();
+		e.info.numberOfDependencies = reader.Read<uint16_t>();
+
+		for (auto &dataInfo : e.fileBlockData)
+		{
+			if (!available(16))
+				return {};
+
+			dataInfo.uncompressedSize = reader.Read<uint32_t>();
+			dataInfo.uncompressedAlignment = reader.Read<uint32_t>();
+			dataInfo.compressedSize = reader.Read<uint32_t>();
+			const auto storedSize = reader.Read<uint32_t>();
+			if (storedSize != (patch.compressed ? dataInfo.compressedSize : dataInfo.uncompressedSize) || !available(storedSize))
+				return {};
+
+			if (storedSize > 0)
+			{
+				const auto begin = buffer->begin() + reader.GetOffset();
+				dataInfo.data = std::make_shared<const std::vector<uint8_t>>(begin, begin + storedSize);
+				reader.Seek(storedSize, std::ios::cur);
+			}
+		}
+
+		if (!available(4))
+			return {};
+		const auto dependencyCount = reader.Read<uint32_t>();
+		if (!available(uint64_t(dependencyCount) * 8 + 1))
+			return {};
+		if (dependencyCount > 0)
+		{
+			auto &dependencies = patch.dependencies[resourceID];
+			for (auto j = 0U; j < dependencyCount; j++)
+			{
+				const auto dependencyID = reader.Read<uint32_t>();
+				dependencies.push_back({ dependencyID, reader.Read<uint32_t>() });
+			}
+		}
+
+		if (reader.Read<uint8_t>() != 0)
+		{
+			auto &debugInfo = patch.debugInfo[resourceID];
+			if (!readString(debugInfo.name) || !readString(debugInfo.typeName))
+				return {};
+		}
+
+		(added ? patch.added : patch.changed).push_back(resourceID);
+		patch.entries[resourceID] = std::move(e);
+	}
+
+	return patch;
+}
+
+void Bundle::SetAccessTrace(std::shared_ptr<AccessTrace> accessTrace)
+{
+	m_accessTrace = std::move(accessTrace);
+}
+
+void Bundle::SetDecompressionCache(std::shared_ptr<DecompressionCache> decompressionCache)
+{
+	m_decompressionCache = std::move(decompressionCache);
+}
+
+std::vector<uint32_t> Bundle::ListResourceIDs() const
+{
+	std::vector<uint32_t> entries;
+	entries.reserve(m_entries.size());
+	for (const auto &e : m_entries)
+	{
+		entries.push_back(e.first);
+	}
+	return entries;
+}
+
+std::map<Bundle::ResourceType, std::vector<uint32_t>> Bundle::ListResourceIDsByType() const
+{
+	return m_resourceIDsByType;
+}
+
+std::vector<Bundle::ResourceType> Bundle::ListResourceTypes() const
+{
+	std::vector<ResourceType> resourceTypes;
+	resourceTypes.reserve(m_resourceIDsByType.size());
+	for (const auto &resourceIDs : m_resourceIDsByType)
+		resourceTypes.push_back(resourceIDs.first);
+	return resourceTypes;
+}
+
+Bundle::ResourceRange Bundle::GetResources() const
+{
+	return {
+		ResourceIterator(m_entries.begin(), m_entries.end(), m_debugInfoEntries.begin(), m_debugInfoEntries.end()),
+		ResourceIterator(m_entries.end(), m_entries.end(), m_debugInfoEntries.end(), m_debugInfoEntries.end())
+	};
+}
+
+Bundle::ResourceIDView Bundle::GetResourceIDs(ResourceType resourceType) const
+{
+	const auto it = m_resourceIDsByType.find(resourceType);
+	if (it == m_resourceIDsByType.end())
+		return {};
+
+	return { it->second.data(), it->second.data() + it->second.size() };
+}
+
+void Bundle::RebuildTypeIndex()
+{
+	m_resourceIDsByType.clear();
+	for (const auto &e : m_entries)
+		m_resourceIDsByType[e.second.info.resourceType].push_back(e.first);
+}
+
+void Bundle::IndexResource(uint32_t resourceID)
+{
+	auto &resourceIDs = m_resourceIDsByType[m_entries.at(resourceID).info.resourceType];
+	const auto it = std::lower_bound(resourceIDs.begin(), resourceIDs.end(), resourceID);
+	if (it == resourceIDs.end() || *it != resourceID)
+		resourceIDs.insert(it, resourceID);
+}
+
+void Bundle::UnindexResource(uint32_t resourceID)
+{
+	const auto type = m_resourceIDsByType.find(m_entries.at(resourceID).info.resourceType);
+	if (type == m_resourceIDsByType.end())
+		return;
+
+	auto &resourceIDs = type->second;
+	const auto it = std::lower_bound(resourceIDs.begin(), resourceIDs.end(), resourceID);
+	if (it != resourceIDs.end() && *it == resourceID)
+		resourceIDs.erase(it);
+	if (resourceIDs.empty())
+		m_resourceIDsByType.erase(type);
 }
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// SSSE3 isn't enabled by default on x86 compilers, so the shuffle is compiled for it explicitly and only
+// used when the CPU reports it.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	include <tmmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+#	if defined(__GNUC__) || defined(__clang__)
+#		define LIBBNDL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#	else
+#		define LIBBNDL_TARGET_SSSE3
+#	endif
+#	define LIBBNDL_BYTESWAP_SSSE3
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	include <arm_neon.h>
+#	define LIBBNDL_BYTESWAP_NEON
+#endif
+
+namespace libbndl::detail
+{
+#if defined(LIBBNDL_BYTESWAP_SSSE3)
+	inline bool HasSSSE3()
+	{
+#	if defined(__SSSE3__)
+		return true;
+#	elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+#	else
+		return __builtin_cpu_supports("ssse3");
+#	endif
+	}
+
+	LIBBNDL_TARGET_SSSE3 inline void SwapDependencyTableSSSE3(uint8_t *data, size_t count)
+	{
+		const auto mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12);
+		for (size_t i = 0; i < count; i++)
+		{
+			auto *record = reinterpret_cast<__m128i *>(data + i * 16);
+			_mm_storeu_si128(record, _mm_shuffle_epi8(_mm_loadu_si128(record), mask));
+		}
+	}
+#endif
+
+	// Import tables are arrays of 16-byte records: a 64-bit resource ID, a 32-bit internal offset
+	// and 32 bits of padding. One shuffle swaps the endianness of a whole record.
+	inline void SwapDependencyTable(uint8_t *data, size_t count)
+	{
+		size_t i = 0;
+
+#if defined(LIBBNDL_BYTESWAP_SSSE3)
+		static const auto hasSSSE3 = HasSSSE3();
+		if (hasSSSE3)
+		{
+			SwapDependencyTableSSSE3(data, count);
+			return;
+		}
+#elif defined(LIBBNDL_BYTESWAP_NEON)
+		static const uint8_t maskBytes[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12 };
+		const auto mask = vld1q_u8(maskBytes);
+		for (; i < count; i++)
+		{
+			auto *record = data + i * 16;
+			vst1q_u8(record, vqtbl1q_u8(vld1q_u8(record), mask));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			auto *record = data + i * 16;
+			for (auto j = 0; j < 4; j++)
+				std::swap(record[j], record[7 - j]);
+			std::swap(record[8], record[11]);
+			std::swap(record[9], record[10]);
+			std::swap(record[12], record[15]);
+			std::swap(record[13], record[14]);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#include "codec.hpp"
+#include <memory>
+
+#include <zlib.h>
+#if defined(LIBBNDL_USE_LIBDEFLATE)
+#include <libdeflate.h>
+#endif
+
+using namespace libbndl::detail;
+
+#if defined(LIBBNDL_USE_LIBDEFLATE)
+
+namespace
+{
+	// libdeflate state is not thread safe, and the compressor is expensive to set up at high
+	// levels, so each thread keeps its own.
+	struct CompressorDeleter
+	{
+		void operator()(libdeflate_compressor *compressor) const
+		{
+			libdeflate_free_compressor(compressor);
+		}
+	};
+
+	struct DecompressorDeleter
+	{
+		void operator()(libdeflate_decompressor *decompressor) const
+		{
+			libdeflate_free_decompressor(decompressor);
+		}
+	};
+
+	libdeflate_compressor *GetCompressor()
+	{
+		thread_local std::unique_ptr<libdeflate_compressor, CompressorDeleter> compressor(libdeflate_alloc_compressor(12));
+		return compressor.get();
+	}
+
+	libdeflate_decompressor *GetDecompressor()
+	{
+		thread_local std::unique_ptr<libdeflate_decompressor, DecompressorDeleter> decompressor(libdeflate_alloc_decompressor());
+		return decompressor.get();
+	}
+}
+
+bool codec::Inflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize)
+{
+	auto *decompressor = GetDecompressor();
+	if (decompressor == nullptr)
+		return false;
+
+	size_t actualSize = 0;
+	const auto ret = libdeflate_zlib_decompress(decompressor, in, inSize, out, outSize, &actualSize);
+	return ret == LIBDEFLATE_SUCCESS && actualSize == outSize;
+}
+
+size_t codec::DeflateBound(size_t inSize)
+{
+	return libdeflate_zlib_compress_bound(nullptr, inSize);
+}
+
+size_t codec::Deflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outCapacity)
+{
+	auto *compressor = GetCompressor();
+	if (compressor == nullptr)
+		return 0;
+
+	return libdeflate_zlib_compress(compressor, in, inSize, out, outCapacity);
+}
+
+#else
+
+bool codec::Inflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize)
+{
+	uLongf actualSize = static_cast<uLongf>(outSize);
+	const auto ret = uncompress(out, &actualSize, in, static_cast<uLong>(inSize));
+	return ret == Z_OK && actualSize == outSize;
+}
+
+size_t codec::DeflateBound(size_t inSize)
+{
+	return compressBound(static_cast<uLong>(inSize));
+}
+
+size_t codec::Deflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outCapacity)
+{
+	uLongf actualSize = static_cast<uLongf>(outCapacity);
+	const auto ret = compress2(out, &actualSize, in, static_cast<uLong>(inSize), Z_BEST_COMPRESSION);
+	return (ret == Z_OK) ? actualSize : 0;
+}
+
+#endif
+
+size_t codec::InflatePrefix(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize)
+{
+	z_stream stream = {};
+	if (inflateInit(&stream) != Z_OK)
+		return 0;
+
+	stream.next_in = const_cast<Bytef *>(in);
+	stream.avail_in = static_cast<uInt>(inSize);
+	stream.next_out = out;
+	stream.avail_out = static_cast<uInt>(outSize);
+
+	int ret;
+	do
+	{
+		ret = inflate(&stream, Z_SYNC_FLUSH);
+	} while (ret == Z_OK && stream.avail_out > 0 && stream.avail_in > 0);
+
+	const auto produced = outSize - stream.avail_out;
+	inflateEnd(&stream);
+
+	return (ret == Z_OK || ret == Z_STREAM_END || (ret == Z_BUF_ERROR && produced == outSize)) ? produced : 0;
+}
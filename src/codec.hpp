@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Whole-buffer zlib stream compression for resource blocks. The backend is picked at build
+// time with LIBBNDL_COMPRESSION; every backend reads and writes the same zlib format.
+namespace libbndl::detail::codec
+{
+	// Inflates a complete zlib stream. Fails unless it produces exactly outSize bytes.
+	bool Inflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize);
+
+	// Inflates only until outSize bytes are produced or the stream ends, returning the number of bytes
+	// produced, or 0 on error. Always zlib, as not every backend can stop early.
+	size_t InflatePrefix(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize);
+
+	size_t DeflateBound(size_t inSize);
+	// Compresses at the backend's best level. Returns the compressed size, or 0 on failure.
+	size_t Deflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outCapacity);
+}
@@ -0,0 +1,180 @@
+#include <libbndl/decompressioncache.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "codec.hpp"
+#include "hash.hpp"
+#include "system.hpp"
+
+using namespace libbndl;
+namespace fs = std::filesystem;
+
+namespace
+{
+	const fs::path BlockExtension = ".blk";
+	const fs::path TempExtension = ".tmp";
+	// Stores take well under this, so older temporary files were left behind by processes that died mid-write.
+	constexpr auto StaleTempAge = std::chrono::hours(1);
+}
+
+DecompressionCache::DecompressionCache(const std::string &directory, uint64_t maximumSize, uint32_t minimumBlockSize)
+{
+	m_directory = directory;
+	m_maximumSize = maximumSize;
+	m_minimumBlockSize = minimumBlockSize;
+
+	std::error_code error;
+	fs::create_directories(m_directory, error);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Trim();
+}
+
+bool DecompressionCache::Inflate(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize)
+{
+	if (outSize == 0 || outSize < m_minimumBlockSize)
+		return detail::codec::Inflate(in, inSize, out, outSize);
+
+	const auto path = GetPath(in, inSize, outSize);
+
+	detail::MappedFile file;
+	if (file.Open(path) && file.GetSize() == outSize)
+	{
+		std::memcpy(out, file.GetData(), outSize);
+		file.Close();
+
+		// Eviction goes by modification time, so a hit counts as a use.
+		std::error_code error;
+		fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+		return true;
+	}
+	file.Close();
+
+	if (!detail::codec::Inflate(in, inSize, out, outSize))
+		return false;
+
+	Store(path, out, outSize);
+	return true;
+}
+
+uint64_t DecompressionCache::GetSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_size;
+}
+
+void DecompressionCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code error;
+	for (fs::directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code removeError;
+		if (it->path().extension() == BlockExtension)
+			fs::remove(it->path(), removeError);
+	}
+	m_size = 0;
+}
+
+std::string DecompressionCache::GetPath(const uint8_t *in, size_t inSize, size_t outSize) const
+{
+	std::ostringstream name;
+	name << std::hex << std::setfill('0') << std::setw(16) << detail::XXH64::Hash(in, inSize) << '-' << outSize;
+	return (fs::path(m_directory) / name.str()).replace_extension(BlockExtension).string();
+}
+
+void DecompressionCache::Store(const std::string &path, const uint8_t *data, size_t size)
+{
+	// Written under a name of its own and then renamed into place, so other processes never map a partial block.
+	std::ostringstream tempPath;
+	tempPath << path << '.' << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id())
+		<< std::chrono::steady_clock::now().time_since_epoch().count() << TempExtension.string();
+
+	std::ofstream f(tempPath.str(), std::ios::out | std::ios::binary);
+	f.write(reinterpret_cast<const char *>(data), size);
+	f.close();
+
+	std::error_code error;
+	if (f.fail())
+	{
+		fs::remove(tempPath.str(), error);
+		return;
+	}
+
+	// Another process may have stored the same block meanwhile; replacing it doesn't grow the cache.
+	const auto replaced = fs::exists(path, error);
+	fs::rename(tempPath.str(), path, error);
+	if (error)
+	{
+		fs::remove(tempPath.str(), error);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!replaced)
+		m_size += size;
+	if (m_size > m_maximumSize)
+		Trim();
+}
+
+void DecompressionCache::Trim()
+{
+	struct CachedBlock
+	{
+		fs::path path;
+		uint64_t size;
+		fs::file_time_type lastUsed;
+	};
+
+	std::vector<CachedBlock> blocks;
+	m_size = 0;
+
+	const auto now = fs::file_time_type::clock::now();
+	std::error_code error;
+	for (fs::directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code entryError;
+		if (it->path().extension() == TempExtension)
+		{
+			const auto lastWrite = it->last_write_time(entryError);
+			if (!entryError && now - lastWrite > StaleTempAge)
+				fs::remove(it->path(), entryError);
+			continue;
+		}
+
+		if (it->path().extension() != BlockExtension || !it->is_regular_file(entryError))
+			continue;
+
+		const auto size = it->file_size(entryError);
+		const auto lastUsed = it->last_write_time(entryError);
+		if (entryError)
+			continue;
+
+		blocks.push_back({ it->path(), size, lastUsed });
+		m_size += size;
+	}
+
+	if (m_size <= m_maximumSize)
+		return;
+
+	// Trim well below the cap, so the next few stores do not each rescan the directory.
+	const auto target = m_maximumSize / 10 * 9;
+	std::sort(blocks.begin(), blocks.end(), [](const CachedBlock &a, const CachedBlock &b) { return a.lastUsed < b.lastUsed; });
+	for (const auto &block : blocks)
+	{
+		if (m_size <= target)
+			break;
+
+		// Blocks still mapped elsewhere may fail to be removed on Windows; they go on the next trim.
+		std::error_code removeError;
+		if (fs::remove(block.path, removeError))
+			m_size -= block.size;
+	}
+}
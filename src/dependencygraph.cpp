@@ -0,0 +1,320 @@
+#include <libbndl/dependencygraph.hpp>
+#include <libbndl/bundle.hpp>
+#include "parallel.hpp"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+
+using namespace libbndl;
+
+DependencyGraph::DependencyGraph(const Bundle &bundle)
+{
+	AddBundle(bundle);
+}
+
+DependencyGraph::DependencyGraph(const std::vector<const Bundle *> &bundles)
+{
+	for (const auto *bundle : bundles)
+		AddBundle(*bundle);
+}
+
+void DependencyGraph::AddBundle(const Bundle &bundle)
+{
+	std::lock_guard<std::mutex> lock(m_buildMutex);
+	m_bundles.push_back(&bundle);
+	m_nodes.clear();
+	m_built = false;
+}
+
+void DependencyGraph::Build() const
+{
+	std::lock_guard<std::mutex> lock(m_buildMutex);
+	if (m_built)
+		return;
+
+	std::vector<std::pair<const Bundle *, uint32_t>> resources;
+	for (const auto *bundle : m_bundles)
+	{
+		for (const auto resourceID : bundle->ListResourceIDs())
+		{
+			// The first bundle to store a resource owns it.
+			auto &node = m_nodes[resourceID];
+			if (node.bundle != nullptr)
+				continue;
+			node.bundle = bundle;
+			resources.emplace_back(bundle, resourceID);
+		}
+	}
+
+	// Reading BND2 imports means inflating block 0, so do that on all cores.
+	std::vector<std::vector<uint32_t>> dependencies(resources.size());
+	detail::ParallelFor(resources.size(), [&](size_t i)
+	{
+		const auto [bundle, resourceID] = resources[i];
+		const auto resourceDependencies = bundle->GetDependencies(resourceID);
+		if (!resourceDependencies)
+			return;
+
+		auto &ids = dependencies[i];
+		for (const auto &dependency : *resourceDependencies)
+			ids.push_back(dependency.resourceID);
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	});
+
+	for (auto i = 0U; i < resources.size(); i++)
+	{
+		const auto resourceID = resources[i].second;
+		for (const auto dependencyID : dependencies[i])
+			m_nodes[dependencyID].dependents.push_back(resourceID);
+		m_nodes[resourceID].dependencies = std::move(dependencies[i]);
+	}
+
+	for (auto &node : m_nodes)
+		std::sort(node.second.dependents.begin(), node.second.dependents.end());
+
+	m_built = true;
+}
+
+const DependencyGraph::Node *DependencyGraph::FindNode(uint32_t resourceID) const
+{
+	Build();
+
+	const auto it = m_nodes.find(resourceID);
+	if (it == m_nodes.end())
+		return nullptr;
+
+	return &it->second;
+}
+
+bool DependencyGraph::Contains(uint32_t resourceID) const
+{
+	return FindBundle(resourceID) != nullptr;
+}
+
+const Bundle *DependencyGraph::FindBundle(uint32_t resourceID) const
+{
+	const auto *node = FindNode(resourceID);
+	return node ? node->bundle : nullptr;
+}
+
+const std::vector<uint32_t> &DependencyGraph::GetDependencies(uint32_t resourceID) const
+{
+	static const std::vector<uint32_t> none;
+	const auto *node = FindNode(resourceID);
+	return node ? node->dependencies : none;
+}
+
+const std::vector<uint32_t> &DependencyGraph::GetDependents(uint32_t resourceID) const
+{
+	static const std::vector<uint32_t> none;
+	const auto *node = FindNode(resourceID);
+	return node ? node->dependents : none;
+}
+
+std::vector<uint32_t> DependencyGraph::Walk(uint32_t resourceID, bool dependents) const
+{
+	std::vector<uint32_t> result;
+	std::unordered_set<uint32_t> visited = { resourceID };
+	std::vector<uint32_t> stack = { resourceID };
+	while (!stack.empty())
+	{
+		const auto current = stack.back();
+		stack.pop_back();
+
+		const auto *node = FindNode(current);
+		if (node == nullptr)
+			continue;
+
+		for (const auto next : dependents ? node->dependents : node->dependencies)
+		{
+			if (visited.insert(next).second)
+			{
+				result.push_back(next);
+				stack.push_back(next);
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+std::vector<uint32_t> DependencyGraph::GetTransitiveDependencies(uint32_t resourceID) const
+{
+	return Walk(resourceID, false);
+}
+
+std::vector<uint32_t> DependencyGraph::GetTransitiveDependents(uint32_t resourceID) const
+{
+	return Walk(resourceID, true);
+}
+
+std::optional<std::vector<uint32_t>> DependencyGraph::GetLoadOrder() const
+{
+	Build();
+
+	// Kahn's algorithm over stored resources, smallest ID first so the order is deterministic.
+	std::unordered_map<uint32_t, size_t> pending;
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+	for (const auto &[resourceID, node] : m_nodes)
+	{
+		if (node.bundle == nullptr)
+			continue;
+
+		const auto count = std::count_if(node.dependencies.begin(), node.dependencies.end(), [this](uint32_t dependencyID)
+		{
+			return m_nodes.at(dependencyID).bundle != nullptr;
+		});
+		if (count == 0)
+			ready.push(resourceID);
+		else
+			pending[resourceID] = count;
+	}
+
+	std::vector<uint32_t> order;
+	while (!ready.empty())
+	{
+		const auto resourceID = ready.top();
+		ready.pop();
+		order.push_back(resourceID);
+
+		for (const auto dependentID : m_nodes.at(resourceID).dependents)
+		{
+			const auto it = pending.find(dependentID);
+			if (it != pending.end() && --it->second == 0)
+			{
+				pending.erase(it);
+				ready.push(dependentID);
+			}
+		}
+	}
+
+	if (!pending.empty())
+		return {};
+
+	return order;
+}
+
+std::vector<uint32_t> DependencyGraph::GetLoadOrder(uint32_t resourceID) const
+{
+	Build();
+
+	// Iterative post-order DFS: a resource is emitted once all of its dependencies are.
+	std::vector<uint32_t> order;
+	std::unordered_set<uint32_t> visited = { resourceID };
+	std::vector<std::pair<uint32_t, size_t>> stack = { { resourceID, 0 } };
+	while (!stack.empty())
+	{
+		auto &[current, nextDependency] = stack.back();
+		const auto &dependencies = GetDependencies(current);
+		if (nextDependency < dependencies.size())
+		{
+			const auto dependencyID = dependencies[nextDependency++];
+			if (visited.insert(dependencyID).second)
+				stack.emplace_back(dependencyID, 0);
+			continue;
+		}
+
+		if (Contains(current))
+			order.push_back(current);
+		stack.pop_back();
+	}
+
+	return order;
+}
+
+bool DependencyGraph::HasCycles() const
+{
+	return !FindCycles().empty();
+}
+
+std::vector<std::vector<uint32_t>> DependencyGraph::FindCycles() const
+{
+	Build();
+
+	// Tarjan's strongly connected components, iteratively to cope with long import chains.
+	struct State
+	{
+		size_t index;
+		size_t lowLink;
+		bool onStack;
+	};
+	std::unordered_map<uint32_t, State> states;
+	std::vector<uint32_t> componentStack;
+	std::vector<std::vector<uint32_t>> cycles;
+	size_t nextIndex = 0;
+
+	std::vector<uint32_t> roots;
+	for (const auto &node : m_nodes)
+		roots.push_back(node.first);
+	std::sort(roots.begin(), roots.end());
+
+	for (const auto root : roots)
+	{
+		if (states.count(root))
+			continue;
+
+		std::vector<std::pair<uint32_t, size_t>> callStack = { { root, 0 } };
+		states[root] = { nextIndex, nextIndex, true };
+		nextIndex++;
+		componentStack.push_back(root);
+
+		while (!callStack.empty())
+		{
+			const auto current = callStack.back().first;
+			auto &nextDependency = callStack.back().second;
+			const auto &dependencies = m_nodes.at(current).dependencies;
+
+			if (nextDependency < dependencies.size())
+			{
+				const auto dependencyID = dependencies[nextDependency++];
+				const auto it = states.find(dependencyID);
+				if (it == states.end())
+				{
+					states[dependencyID] = { nextIndex, nextIndex, true };
+					nextIndex++;
+					componentStack.push_back(dependencyID);
+					callStack.emplace_back(dependencyID, 0);
+				}
+				else if (it->second.onStack)
+				{
+					auto &state = states.at(current);
+					state.lowLink = std::min(state.lowLink, it->second.index);
+				}
+				continue;
+			}
+
+			callStack.pop_back();
+			const auto state = states.at(current);
+			if (!callStack.empty())
+			{
+				auto &parentState = states.at(callStack.back().first);
+				parentState.lowLink = std::min(parentState.lowLink, state.lowLink);
+			}
+
+			if (state.lowLink != state.index)
+				continue;
+
+			std::vector<uint32_t> component;
+			uint32_t member;
+			do
+			{
+				member = componentStack.back();
+				componentStack.pop_back();
+				states.at(member).onStack = false;
+				component.push_back(member);
+			} while (member != current);
+
+			const auto selfImport = std::binary_search(dependencies.begin(), dependencies.end(), current);
+			if (component.size() > 1 || selfImport)
+			{
+				std::sort(component.begin(), component.end());
+				cycles.push_back(std::move(component));
+			}
+		}
+	}
+
+	return cycles;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <zlib.h>
+
+namespace libbndl::detail
+{
+	// XXH64 (https://github.com/Cyan4973/xxHash), used for content addressing blocks.
+	class XXH64
+	{
+	public:
+		static uint64_t Hash(const uint8_t *data, size_t size, uint64_t seed = 0)
+		{
+			const auto *p = data;
+			const auto *end = data + size;
+			uint64_t h;
+
+			if (size >= 32)
+			{
+				uint64_t v1 = seed + Prime1 + Prime2;
+				uint64_t v2 = seed + Prime2;
+				uint64_t v3 = seed;
+				uint64_t v4 = seed - Prime1;
+				for (; p + 32 <= end; p += 32)
+				{
+					v1 = Round(v1, Read64(p));
+					v2 = Round(v2, Read64(p + 8));
+					v3 = Round(v3, Read64(p + 16));
+					v4 = Round(v4, Read64(p + 24));
+				}
+
+				h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+				h = MergeRound(h, v1);
+				h = MergeRound(h, v2);
+				h = MergeRound(h, v3);
+				h = MergeRound(h, v4);
+			}
+			else
+			{
+				h = seed + Prime5;
+			}
+
+			h += static_cast<uint64_t>(size);
+
+			for (; p + 8 <= end; p += 8)
+				h = Rotl(h ^ Round(0, Read64(p)), 27) * Prime1 + Prime4;
+			if (p + 4 <= end)
+			{
+				h = Rotl(h ^ (static_cast<uint64_t>(Read32(p)) * Prime1), 23) * Prime2 + Prime3;
+				p += 4;
+			}
+			for (; p < end; p++)
+				h = Rotl(h ^ (*p * Prime5), 11) * Prime1;
+
+			h ^= h >> 33;
+			h *= Prime2;
+			h ^= h >> 29;
+			h *= Prime3;
+			h ^= h >> 32;
+			return h;
+		}
+
+	private:
+		static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+		static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+		static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+		static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+		static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+		static uint64_t Rotl(uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		// xxHash is defined over little endian input.
+		static uint64_t Read64(const uint8_t *p)
+		{
+			uint64_t v = 0;
+			for (auto i = 0; i < 8; i++)
+				v |= static_cast<uint64_t>(p[i]) << (8 * i);
+			return v;
+		}
+
+		static uint32_t Read32(const uint8_t *p)
+		{
+			uint32_t v = 0;
+			for (auto i = 0; i < 4; i++)
+				v |= static_cast<uint32_t>(p[i]) << (8 * i);
+			return v;
+		}
+
+		static uint64_t Round(uint64_t acc, uint64_t input)
+		{
+			acc += input * Prime2;
+			acc = Rotl(acc, 31);
+			return acc * Prime1;
+		}
+
+		static uint64_t MergeRound(uint64_t acc, uint64_t val)
+		{
+			acc ^= Round(0, val);
+			return acc * Prime1 + Prime4;
+		}
+	};
+
+	// Resource IDs are the CRC32 of the lowercased name. Lowercasing goes through a small stack buffer,
+	// so hashing never allocates.
+	inline uint32_t HashResourceName(const char *name, size_t length)
+	{
+		uint8_t buffer[256];
+		uLong crc = crc32_z(0, nullptr, 0);
+		while (length > 0)
+		{
+			const auto chunk = (length < sizeof(buffer)) ? length : sizeof(buffer);
+			for (size_t i = 0; i < chunk; i++)
+			{
+				const auto c = static_cast<uint8_t>(name[i]);
+				buffer[i] = (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+			}
+
+			crc = crc32_z(crc, buffer, chunk);
+			name += chunk;
+			length -= chunk;
+		}
+		return static_cast<uint32_t>(crc);
+	}
+}
@@ -0,0 +1,157 @@
+#include "inflateindex.hpp"
+#include "hash.hpp"
+#include <binaryio/binaryreader.hpp>
+#include <binaryio/binarywriter.hpp>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+using namespace libbndl::detail;
+
+std::optional<InflateIndex> InflateIndex::Build(const uint8_t *in, size_t inSize, size_t spacing, const std::atomic<bool> *cancelled)
+{
+	z_stream stream = {};
+	if (inflateInit(&stream) != Z_OK)
+		return {};
+
+	InflateIndex index;
+	std::vector<uint8_t> window(WindowSize);
+	uint64_t totalIn = 0;
+	uint64_t totalOut = 0;
+	uint64_t last = 0;
+
+	stream.next_in = const_cast<Bytef *>(in);
+	stream.avail_in = static_cast<uInt>(inSize);
+
+	int ret;
+	do
+	{
+		// The output buffer is a ring over the last 32K, which is all a checkpoint needs.
+		if (stream.avail_out == 0)
+		{
+			stream.next_out = window.data();
+			stream.avail_out = static_cast<uInt>(window.size());
+		}
+
+		totalIn += stream.avail_in;
+		totalOut += stream.avail_out;
+		ret = inflate(&stream, Z_BLOCK);
+		totalIn -= stream.avail_in;
+		totalOut -= stream.avail_out;
+
+		if ((ret != Z_OK && ret != Z_STREAM_END) || (cancelled != nullptr && *cancelled))
+		{
+			inflateEnd(&stream);
+			return {};
+		}
+
+		// At the end of a deflate block that is not the last one.
+		if (ret == Z_OK && (stream.data_type & 128) && !(stream.data_type & 64) && (totalOut == 0 || totalOut - last > spacing))
+		{
+			auto &checkpoint = index.m_checkpoints.emplace_back();
+			checkpoint.out = totalOut;
+			checkpoint.in = totalIn;
+			checkpoint.bits = static_cast<uint8_t>(stream.data_type & 7);
+
+			const auto left = stream.avail_out;
+			std::memcpy(checkpoint.window.data(), window.data() + WindowSize - left, left);
+			std::memcpy(checkpoint.window.data() + left, window.data(), WindowSize - left);
+
+			last = totalOut;
+		}
+	} while (ret != Z_STREAM_END && (stream.avail_in > 0 || stream.avail_out == 0));
+
+	inflateEnd(&stream);
+	if (ret != Z_STREAM_END)
+		return {};
+
+	index.m_compressedSize = inSize;
+	index.m_uncompressedSize = totalOut;
+	index.m_streamHash = XXH64::Hash(in, inSize);
+	return index;
+}
+
+bool InflateIndex::Extract(const uint8_t *in, size_t inSize, uint64_t offset, uint8_t *out, size_t size) const
+{
+	const auto next = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), offset, [](uint64_t value, const Checkpoint &checkpoint) { return value < checkpoint.out; });
+	if (next == m_checkpoints.begin())
+		return false;
+	const auto &checkpoint = *std::prev(next);
+	if (checkpoint.in > inSize || (checkpoint.bits != 0 && checkpoint.in == 0))
+		return false;
+
+	z_stream stream = {};
+	if (inflateInit2(&stream, -15) != Z_OK) // raw deflate, we start in the middle of the stream
+		return false;
+
+	stream.next_in = const_cast<Bytef *>(in + checkpoint.in);
+	stream.avail_in = static_cast<uInt>(inSize - checkpoint.in);
+	if (checkpoint.bits != 0)
+		inflatePrime(&stream, checkpoint.bits, in[checkpoint.in - 1] >> (8 - checkpoint.bits));
+	inflateSetDictionary(&stream, checkpoint.window.data(), WindowSize);
+
+	// Inflate and throw away everything between the checkpoint and the requested offset.
+	auto skip = offset - checkpoint.out;
+	std::vector<uint8_t> discard(static_cast<size_t>(std::min<uint64_t>(skip, WindowSize)));
+	auto ret = Z_OK;
+	while (skip > 0 && ret == Z_OK)
+	{
+		stream.next_out = discard.data();
+		stream.avail_out = static_cast<uInt>(std::min<uint64_t>(skip, discard.size()));
+		const auto before = stream.avail_out;
+		ret = inflate(&stream, Z_NO_FLUSH);
+		skip -= before - stream.avail_out;
+	}
+
+	stream.next_out = out;
+	stream.avail_out = static_cast<uInt>(size);
+	while (skip == 0 && stream.avail_out > 0 && ret == Z_OK)
+		ret = inflate(&stream, Z_NO_FLUSH);
+
+	inflateEnd(&stream);
+	return skip == 0 && stream.avail_out == 0 && (ret == Z_OK || ret == Z_STREAM_END);
+}
+
+void InflateIndex::Save(binaryio::BinaryWriter &writer) const
+{
+	writer.Write<uint64_t>(m_compressedSize);
+	writer.Write<uint64_t>(m_uncompressedSize);
+	writer.Write(static_cast<uint32_t>(m_checkpoints.size()));
+	for (const auto &checkpoint : m_checkpoints)
+	{
+		writer.Write<uint64_t>(checkpoint.out);
+		writer.Write<uint64_t>(checkpoint.in);
+		writer.Write<uint32_t>(checkpoint.bits);
+		writer.Write(checkpoint.window.data(), checkpoint.window.size());
+	}
+}
+
+std::optional<InflateIndex> InflateIndex::Load(binaryio::BinaryReader &reader, uint64_t available)
+{
+	constexpr uint64_t HeaderSize = 20;
+	constexpr uint64_t CheckpointSize = 20 + WindowSize;
+	if (available < HeaderSize)
+		return {};
+
+	InflateIndex index;
+	index.m_compressedSize = reader.Read<uint64_t>();
+	index.m_uncompressedSize = reader.Read<uint64_t>();
+	const auto count = reader.Read<uint32_t>();
+	if (available - HeaderSize < count * CheckpointSize)
+		return {};
+
+	index.m_checkpoints.resize(count);
+	for (auto &checkpoint : index.m_checkpoints)
+	{
+		checkpoint.out = reader.Read<uint64_t>();
+		checkpoint.in = reader.Read<uint64_t>();
+		checkpoint.bits = static_cast<uint8_t>(reader.Read<uint32_t>());
+		if (checkpoint.bits > 7)
+			return {};
+
+		const auto *window = reader.Read<uint8_t *>(WindowSize);
+		std::memcpy(checkpoint.window.data(), window, WindowSize);
+		delete[] window;
+	}
+	return index;
+}
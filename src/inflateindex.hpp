@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace binaryio
+{
+	class BinaryReader;
+	class BinaryWriter;
+}
+
+namespace libbndl::detail
+{
+	// Random access into a zlib stream, after zran.c from the zlib examples: while inflating once, the
+	// decoder state and last 32K of output are saved at deflate block boundaries roughly every `spacing`
+	// bytes. Reads then restart inflation from the nearest checkpoint instead of the start of the stream.
+	class InflateIndex
+	{
+	public:
+		// Gives up as soon as `cancelled` is set.
+		static std::optional<InflateIndex> Build(const uint8_t *in, size_t inSize, size_t spacing, const std::atomic<bool> *cancelled = nullptr);
+
+		// Fails unless `size` bytes starting at `offset` could be produced.
+		bool Extract(const uint8_t *in, size_t inSize, uint64_t offset, uint8_t *out, size_t size) const;
+
+		void Save(binaryio::BinaryWriter &writer) const;
+		// Fails instead of reading past `available` bytes.
+		static std::optional<InflateIndex> Load(binaryio::BinaryReader &reader, uint64_t available);
+
+		// Whether the index was built for a stream of these sizes.
+		bool Matches(uint64_t compressedSize, uint64_t uncompressedSize) const
+		{
+			return m_compressedSize == compressedSize && m_uncompressedSize == uncompressedSize;
+		}
+
+		// XXH64 of the stream Build indexed. Not saved: bundle index files keep it next to each index.
+		uint64_t GetStreamHash() const
+		{
+			return m_streamHash;
+		}
+
+	private:
+		static constexpr size_t WindowSize = 0x8000;
+
+		struct Checkpoint
+		{
+			uint64_t out; // uncompressed offset
+			uint64_t in; // compressed offset of the first full byte
+			uint8_t bits; // bits of the byte before `in` that belong to this point
+			std::array<uint8_t, WindowSize> window;
+		};
+
+		uint64_t m_compressedSize = 0;
+		uint64_t m_uncompressedSize = 0;
+		uint64_t m_streamHash = 0;
+		std::vector<Checkpoint> m_checkpoints;
+	};
+}
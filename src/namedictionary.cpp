@@ -0,0 +1,257 @@
+#include <libbndl/namedictionary.hpp>
+#include <binaryio/binarywriter.hpp>
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "system.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace libbndl;
+
+// File layout, little endian:
+//   "bndn", version, entry count, name block size
+//   entries sorted by ID: { resource ID, offset of the name in the name block }
+//   name block: null terminated names
+namespace
+{
+	constexpr uint32_t FileVersion = 1;
+	constexpr size_t HeaderSize = 0x10;
+	constexpr size_t EntrySize = 8;
+	// Name offsets, the entry count and the name block size are all 32-bit.
+	constexpr uint64_t MaxNamesSize = UINT32_MAX;
+
+	uint32_t ReadU32(const uint8_t *data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+}
+
+NameDictionary::NameDictionary() = default;
+NameDictionary::~NameDictionary() = default;
+
+bool NameDictionary::Add(const std::string &name)
+{
+	return AddHashed({ name });
+}
+
+bool NameDictionary::Add(const std::vector<std::string> &names)
+{
+	return AddHashed(std::vector<std::string_view>(names.begin(), names.end()));
+}
+
+bool NameDictionary::AddFile(const std::string &name)
+{
+	std::ifstream stream(name, std::ios::in | std::ios::binary);
+	if (stream.fail())
+		return false;
+
+	std::stringstream contents;
+	contents << stream.rdbuf();
+	const auto text = contents.str();
+
+	std::vector<std::string_view> names;
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		auto lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = text.size();
+
+		auto line = std::string_view(text).substr(lineStart, lineEnd - lineStart);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		if (!line.empty())
+			names.push_back(line);
+
+		lineStart = lineEnd + 1;
+	}
+
+	return AddHashed(names);
+}
+
+bool NameDictionary::AddHashed(const std::vector<std::string_view> &names)
+{
+	Materialize();
+
+	uint64_t namesSize = m_names.size();
+	for (const auto &name : names)
+		namesSize += name.size() + 1;
+	if (namesSize > MaxNamesSize || m_entries.size() + names.size() > UINT32_MAX)
+		return false;
+
+	std::vector<uint32_t> resourceIDs(names.size());
+	detail::ParallelFor((names.size() + 0xFFFF) / 0x10000, [&](size_t chunk)
+	{
+		const auto end = std::min(names.size(), (chunk + 1) * 0x10000);
+		for (auto i = chunk * 0x10000; i < end; i++)
+			resourceIDs[i] = detail::HashResourceName(names[i].data(), names[i].size());
+	});
+
+	m_entries.reserve(m_entries.size() + names.size());
+	for (auto i = 0U; i < names.size(); i++)
+	{
+		m_entries.push_back({ resourceIDs[i], static_cast<uint32_t>(m_names.size()) });
+		m_names.append(names[i]);
+		m_names.push_back('\0');
+	}
+	m_sorted = false;
+	return true;
+}
+
+void NameDictionary::Materialize()
+{
+	if (m_file == nullptr)
+		return;
+
+	const auto *data = m_file->GetData();
+	const auto *names = data + HeaderSize + m_mappedCount * EntrySize;
+	m_entries.resize(m_mappedCount);
+	for (auto i = 0U; i < m_mappedCount; i++)
+	{
+		const auto *entry = data + HeaderSize + i * EntrySize;
+		m_entries[i] = { ReadU32(entry), ReadU32(entry + 4) };
+	}
+	m_names.assign(reinterpret_cast<const char *>(names), m_file->GetSize() - (names - data));
+
+	m_file.reset();
+	m_mappedCount = 0;
+}
+
+void NameDictionary::Sort() const
+{
+	if (m_sorted)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_sortMutex);
+	if (m_sorted)
+		return;
+
+	std::sort(m_entries.begin(), m_entries.end(), [this](const Entry &a, const Entry &b)
+	{
+		if (a.resourceID != b.resourceID)
+			return a.resourceID < b.resourceID;
+		return GetName(a.nameOffset) < GetName(b.nameOffset);
+	});
+	m_entries.erase(std::unique(m_entries.begin(), m_entries.end(), [this](const Entry &a, const Entry &b)
+	{
+		return a.resourceID == b.resourceID && GetName(a.nameOffset) == GetName(b.nameOffset);
+	}), m_entries.end());
+
+	m_sorted = true;
+}
+
+std::string_view NameDictionary::GetName(uint32_t nameOffset) const
+{
+	if (m_file != nullptr)
+	{
+		const auto *data = m_file->GetData();
+		const auto namesStart = HeaderSize + m_mappedCount * EntrySize;
+		if (namesStart + nameOffset >= m_file->GetSize())
+			return {};
+
+		const auto *name = reinterpret_cast<const char *>(data + namesStart + nameOffset);
+		const auto *end = static_cast<const char *>(std::memchr(name, 0, m_file->GetSize() - namesStart - nameOffset));
+		return std::string_view(name, (end != nullptr) ? end - name : 0);
+	}
+
+	return std::string_view(m_names.c_str() + nameOffset);
+}
+
+bool NameDictionary::Load(const std::string &name)
+{
+	auto file = std::make_unique<detail::MappedFile>();
+	if (!file->Open(name) || file->GetSize() < HeaderSize)
+		return false;
+
+	const auto *data = file->GetData();
+	if (std::memcmp(data, "bndn", 4) != 0 || ReadU32(data + 4) != FileVersion)
+		return false;
+
+	const auto count = ReadU32(data + 8);
+	const auto namesSize = ReadU32(data + 12);
+	if (HeaderSize + static_cast<uint64_t>(count) * EntrySize + namesSize != file->GetSize())
+		return false;
+
+	m_entries.clear();
+	m_entries.shrink_to_fit();
+	m_names.clear();
+	m_names.shrink_to_fit();
+	m_sorted = true;
+
+	m_file = std::move(file);
+	m_mappedCount = count;
+	return true;
+}
+
+bool NameDictionary::Save(const std::string &name) const
+{
+	Sort();
+
+	// Rewrite the names in entry order, leaving out those dropped as duplicates.
+	auto writer = binaryio::BinaryWriter();
+	const auto count = static_cast<uint32_t>(GetSize());
+	writer.Write("bndn", 4);
+	writer.Write<uint32_t>(FileVersion);
+	writer.Write<uint32_t>(count);
+	const auto namesSizePos = writer.GetOffset();
+	writer.Write<uint32_t>(0);
+
+	std::string names;
+	for (auto i = 0U; i < count; i++)
+	{
+		const auto *entry = (m_file != nullptr) ? m_file->GetData() + HeaderSize + i * EntrySize : nullptr;
+		const auto resourceID = (entry != nullptr) ? ReadU32(entry) : m_entries[i].resourceID;
+		const auto nameOffset = (entry != nullptr) ? ReadU32(entry + 4) : m_entries[i].nameOffset;
+
+		writer.Write<uint32_t>(resourceID);
+		writer.Write(static_cast<uint32_t>(names.size()));
+		names.append(GetName(nameOffset));
+		names.push_back('\0');
+	}
+	if (names.size() > MaxNamesSize)
+		return false;
+	writer.Write(names.data(), names.size());
+	writer.VisitAndWrite<uint32_t>(namesSizePos, static_cast<uint32_t>(names.size()));
+
+	std::ofstream f(name, std::ios::out | std::ios::binary);
+	f << writer.GetStream().rdbuf();
+	f.close();
+
+	return !f.fail();
+}
+
+size_t NameDictionary::GetSize() const
+{
+	return (m_file != nullptr) ? m_mappedCount : m_entries.size();
+}
+
+std::optional<std::string_view> NameDictionary::Lookup(uint32_t resourceID) const
+{
+	if (m_file != nullptr)
+	{
+		// Binary search straight over the mapped entries.
+		const auto *entries = m_file->GetData() + HeaderSize;
+		size_t low = 0;
+		size_t high = m_mappedCount;
+		while (low < high)
+		{
+			const auto mid = low + (high - low) / 2;
+			if (ReadU32(entries + mid * EntrySize) < resourceID)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		if (low == m_mappedCount || ReadU32(entries + low * EntrySize) != resourceID)
+			return {};
+		return GetName(ReadU32(entries + low * EntrySize + 4));
+	}
+
+	Sort();
+	const auto it = std::lower_bound(m_entries.begin(), m_entries.end(), resourceID, [](const Entry &entry, uint32_t id) { return entry.resourceID < id; });
+	if (it == m_entries.end() || it->resourceID != resourceID)
+		return {};
+	return GetName(it->nameOffset);
+}
@@ -0,0 +1,188 @@
+#include <libbndl/nameindex.hpp>
+#include <libbndl/bundle.hpp>
+#include "parallel.hpp"
+#include <algorithm>
+#include <cctype>
+
+using namespace libbndl;
+
+namespace
+{
+	std::string ToLower(std::string value)
+	{
+		std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return value;
+	}
+
+	bool GlobMatch(const std::string &value, const std::string &pattern)
+	{
+		size_t v = 0;
+		size_t p = 0;
+		auto starPattern = std::string::npos;
+		size_t starValue = 0;
+		while (v < value.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == value[v]))
+			{
+				v++;
+				p++;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				starPattern = p++;
+				starValue = v;
+			}
+			else if (starPattern != std::string::npos)
+			{
+				// Let the last * swallow one more character and retry from there.
+				p = starPattern + 1;
+				v = ++starValue;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		while (p < pattern.size() && pattern[p] == '*')
+			p++;
+		return p == pattern.size();
+	}
+}
+
+NameIndex::NameIndex(const Bundle &bundle)
+{
+	AddBundle(bundle);
+}
+
+size_t NameIndex::AddBundle(const Bundle &bundle)
+{
+	std::vector<Record> records;
+	for (const auto resourceID : bundle.ListResourceIDs())
+	{
+		auto debugInfo = bundle.GetDebugInfo(resourceID);
+		if (debugInfo)
+			records.push_back({ resourceID, 0, std::move(debugInfo->name), std::move(debugInfo->typeName) });
+	}
+
+	return AddRecords(std::move(records));
+}
+
+size_t NameIndex::AddDebugInfo(const std::map<uint32_t, Bundle::EntryDebugInfo> &debugInfoEntries)
+{
+	std::vector<Record> records;
+	records.reserve(debugInfoEntries.size());
+	for (const auto &[resourceID, debugInfo] : debugInfoEntries)
+		records.push_back({ resourceID, 0, debugInfo.name, debugInfo.typeName });
+
+	return AddRecords(std::move(records));
+}
+
+size_t NameIndex::AddRecords(std::vector<Record> records)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto bundleIndex = m_bundleCount++;
+	for (auto &record : records)
+	{
+		record.bundle = bundleIndex;
+		m_records.push_back(std::move(record));
+	}
+	m_built = false;
+
+	return bundleIndex;
+}
+
+size_t NameIndex::GetSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_records.size();
+}
+
+void NameIndex::Build() const
+{
+	if (m_built)
+		return;
+
+	for (auto field = 0; field < 2; field++)
+	{
+		auto &keys = m_keys[field];
+		keys.clear();
+		keys.reserve(m_records.size());
+		for (auto i = 0U; i < m_records.size(); i++)
+			keys.emplace_back(ToLower((field == Name) ? m_records[i].name : m_records[i].typeName), i);
+		std::sort(keys.begin(), keys.end());
+	}
+
+	m_built = true;
+}
+
+std::vector<NameIndex::Match> NameIndex::Search(const std::string &pattern, MatchMode mode, Field field) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Build();
+
+	const auto &keys = m_keys[field];
+	const auto lowerPattern = ToLower(pattern);
+
+	// Prefix searches, and globs that start with a literal, only need the sorted range sharing that prefix.
+	auto prefix = lowerPattern;
+	if (mode == Glob)
+		prefix = lowerPattern.substr(0, lowerPattern.find_first_of("*?"));
+	else if (mode == Substring)
+		prefix.clear();
+
+	const auto begin = std::lower_bound(keys.begin(), keys.end(), prefix, [](const auto &key, const std::string &value) { return key.first < value; });
+	auto end = begin;
+	if (prefix.empty())
+		end = keys.end();
+	else
+		end = std::find_if(begin, keys.end(), [&prefix](const auto &key) { return key.first.compare(0, prefix.size(), prefix) != 0; });
+
+	const auto isMatch = [&](const std::string &key)
+	{
+		switch (mode)
+		{
+		case Prefix:
+			return true;
+		case Substring:
+			return key.find(lowerPattern) != std::string::npos;
+		default:
+			return GlobMatch(key, lowerPattern);
+		}
+	};
+
+	// Scan in chunks on all cores; concatenating them in order keeps the result sorted.
+	const auto count = static_cast<size_t>(end - begin);
+	const auto chunkSize = std::max<size_t>(count / (detail::HardwareThreads() * 4), 0x4000);
+	std::vector<std::vector<uint32_t>> chunkMatches((count + chunkSize - 1) / chunkSize);
+	detail::ParallelFor(chunkMatches.size(), [&](size_t chunk)
+	{
+		const auto chunkBegin = begin + chunk * chunkSize;
+		const auto chunkEnd = begin + std::min(count, (chunk + 1) * chunkSize);
+		const std::string *lastKey = nullptr;
+		auto lastMatched = false;
+		for (auto it = chunkBegin; it != chunkEnd; ++it)
+		{
+			// Keys repeat a lot, type names especially.
+			if (lastKey == nullptr || *lastKey != it->first)
+			{
+				lastKey = &it->first;
+				lastMatched = isMatch(it->first);
+			}
+
+			if (lastMatched)
+				chunkMatches[chunk].push_back(it->second);
+		}
+	});
+
+	std::vector<Match> matches;
+	for (const auto &chunk : chunkMatches)
+	{
+		for (const auto recordIndex : chunk)
+		{
+			const auto &record = m_records[recordIndex];
+			matches.push_back({ record.resourceID, record.bundle, record.name, record.typeName });
+		}
+	}
+	return matches;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libbndl::detail
+{
+	inline unsigned HardwareThreads()
+	{
+		return std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	// Calls fn(i) for every i in [0, count), spread over up to `threads` workers (0 = all cores).
+	// Work items are handed out one at a time so uneven entry sizes balance themselves.
+	template<typename Fn>
+	void ParallelFor(size_t count, Fn &&fn, unsigned threads = 0)
+	{
+		if (threads == 0)
+			threads = HardwareThreads();
+		threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+
+		if (threads <= 1)
+		{
+			for (size_t i = 0; i < count; i++)
+				fn(i);
+			return;
+		}
+
+		std::atomic<size_t> next = 0;
+		const auto worker = [&]()
+		{
+			for (auto i = next++; i < count; i = next++)
+				fn(i);
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (auto i = 1U; i < threads; i++)
+			workers.emplace_back(worker);
+		worker();
+		for (auto &thread : workers)
+			thread.join();
+	}
+
+	// Long-lived workers for background jobs. Queued jobs still run on destruction.
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(unsigned threads = 0)
+		{
+			if (threads == 0)
+				threads = HardwareThreads();
+			for (auto i = 0U; i < threads; i++)
+				m_workers.emplace_back([this]() { Work(); });
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+			}
+			m_wake.notify_all();
+			for (auto &worker : m_workers)
+				worker.join();
+		}
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		void Submit(std::function<void()> job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_jobs.push_back(std::move(job));
+			}
+			m_wake.notify_one();
+		}
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		bool m_stopping = false;
+
+		void Work()
+		{
+			for (;;)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+					if (m_jobs.empty())
+						return;
+					job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+				}
+				job();
+			}
+		}
+	};
+}
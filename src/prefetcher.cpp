@@ -0,0 +1,67 @@
+#include <libbndl/prefetcher.hpp>
+#include "parallel.hpp"
+
+using namespace libbndl;
+
+Prefetcher::Prefetcher(const Bundle &bundle, unsigned threads)
+	: m_ownedGraph(std::make_unique<DependencyGraph>(bundle)), m_graph(*m_ownedGraph), m_pool(std::make_unique<detail::ThreadPool>(threads))
+{
+}
+
+Prefetcher::Prefetcher(const DependencyGraph &graph, unsigned threads)
+	: m_graph(graph), m_pool(std::make_unique<detail::ThreadPool>(threads))
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+	// Let the pool drain quickly before the graph goes away.
+	Cancel();
+	m_pool.reset();
+}
+
+std::vector<PrefetchedResource> Prefetcher::Prefetch(uint32_t resourceID, size_t memoryBudget)
+{
+	std::vector<PrefetchedResource> resources;
+	const auto generation = m_generation.load();
+
+	size_t budgetUsed = 0;
+	for (const auto id : m_graph.GetLoadOrder(resourceID))
+	{
+		const auto *bundle = m_graph.FindBundle(id);
+
+		size_t size = 0;
+		for (auto i = 0U; i < 3; i++)
+			size += bundle->GetUncompressedSize(id, i).value_or(0);
+		if (budgetUsed + size > memoryBudget)
+			break;
+		budgetUsed += size;
+
+		const auto promise = std::make_shared<std::promise<std::optional<Bundle::EntryData>>>();
+		resources.push_back({ id, promise->get_future() });
+		m_pool->Submit([this, bundle, id, generation, promise]()
+		{
+			if (m_generation != generation)
+			{
+				promise->set_value({});
+				return;
+			}
+
+			try
+			{
+				promise->set_value(bundle->GetData(id));
+			}
+			catch (...)
+			{
+				promise->set_exception(std::current_exception());
+			}
+		});
+	}
+
+	return resources;
+}
+
+void Prefetcher::Cancel()
+{
+	m_generation++;
+}
@@ -0,0 +1,355 @@
+#include <libbndl/sharedindex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "codec.hpp"
+#include "system.hpp"
+
+using namespace libbndl;
+namespace fs = std::filesystem;
+
+// The index is only ever read on the machine that wrote it, so records are laid out in native byte order.
+struct SharedIndex::Header
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t bundleSize;
+	int64_t bundleTime;
+	uint32_t magicVersion;
+	uint32_t revisionNumber;
+	uint32_t platform;
+	uint32_t flags;
+	uint32_t numEntries;
+	uint32_t numDependencies;
+	uint64_t entriesOffset;
+	uint64_t dependenciesOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+struct SharedIndex::Entry
+{
+	struct Block
+	{
+		uint64_t offset; // in the bundle file
+		uint32_t storedSize;
+		uint32_t uncompressedSize;
+		uint32_t alignment;
+		uint32_t padding;
+	};
+
+	uint32_t resourceID;
+	uint32_t resourceType;
+	uint32_t checksum;
+	uint32_t dependenciesOffset;
+	uint32_t firstDependency;
+	uint32_t numberOfDependencies;
+	uint32_t nameOffset; // NoDebugInfo if there is none
+	uint32_t typeNameOffset;
+	Block blocks[3];
+};
+
+namespace
+{
+	constexpr uint32_t FileVersion = 1;
+	constexpr uint32_t NoDebugInfo = 0xFFFFFFFF;
+
+	bool GetFileIdentity(const std::string &name, uint64_t &size, int64_t &time)
+	{
+		std::error_code error;
+		size = fs::file_size(name, error);
+		if (error)
+			return false;
+
+		time = static_cast<int64_t>(fs::last_write_time(name, error).time_since_epoch().count());
+		return !error;
+	}
+
+	template <typename T>
+	void Append(std::vector<uint8_t> &out, const T &value)
+	{
+		const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+}
+
+SharedIndex::SharedIndex() = default;
+SharedIndex::~SharedIndex() = default;
+
+bool SharedIndex::Build(const std::string &bundleName, const std::string &indexName)
+{
+	Header header = {};
+	if (!GetFileIdentity(bundleName, header.bundleSize, header.bundleTime))
+		return false;
+
+	const auto buffer = Bundle::ReadFile(bundleName);
+	Bundle bundle;
+	Bundle::BlockOffsets blockOffsets;
+	if (buffer == nullptr || buffer->size() != header.bundleSize || !bundle.LoadBuffer(buffer, &blockOffsets))
+		return false;
+
+	std::vector<Entry> entries;
+	std::vector<Bundle::Dependency> dependencies;
+	std::string strings;
+	entries.reserve(bundle.m_entries.size());
+	for (const auto &[resourceID, e] : bundle.m_entries)
+	{
+		Entry entry = {};
+		entry.resourceID = resourceID;
+		entry.resourceType = e.info.resourceType;
+		entry.checksum = e.info.checksum;
+		entry.dependenciesOffset = e.info.dependenciesOffset;
+		entry.nameOffset = NoDebugInfo;
+		entry.typeNameOffset = NoDebugInfo;
+
+		const auto entryDependencies = bundle.GetDependencies(resourceID);
+		if (!entryDependencies)
+			return false;
+		entry.firstDependency = static_cast<uint32_t>(dependencies.size());
+		entry.numberOfDependencies = static_cast<uint32_t>(entryDependencies->size());
+		dependencies.insert(dependencies.end(), entryDependencies->begin(), entryDependencies->end());
+
+		const auto debugInfo = bundle.m_debugInfoEntries.find(resourceID);
+		if (debugInfo != bundle.m_debugInfoEntries.end())
+		{
+			entry.nameOffset = static_cast<uint32_t>(strings.size());
+			strings.append(debugInfo->second.name).push_back('\0');
+			entry.typeNameOffset = static_cast<uint32_t>(strings.size());
+			strings.append(debugInfo->second.typeName).push_back('\0');
+		}
+
+		for (auto i = 0; i < 3; i++)
+		{
+			const auto &dataInfo = e.fileBlockData[i];
+			auto &block = entry.blocks[i];
+			block.uncompressedSize = dataInfo.uncompressedSize;
+			block.alignment = dataInfo.uncompressedAlignment;
+			if (dataInfo.data == nullptr)
+				continue;
+
+			block.offset = blockOffsets.at(resourceID)[i];
+			block.storedSize = static_cast<uint32_t>(dataInfo.data->size());
+		}
+
+		entries.push_back(entry);
+	}
+
+	std::memcpy(header.magic, "bndi", 4);
+	header.version = FileVersion;
+	header.magicVersion = bundle.GetMagicVersion();
+	header.revisionNumber = bundle.GetRevisionNumber();
+	header.platform = bundle.GetPlatform();
+	header.flags = bundle.GetFlags();
+	header.numEntries = static_cast<uint32_t>(entries.size());
+	header.numDependencies = static_cast<uint32_t>(dependencies.size());
+	header.entriesOffset = sizeof(Header);
+	header.dependenciesOffset = header.entriesOffset + entries.size() * sizeof(Entry);
+	header.stringsOffset = header.dependenciesOffset + dependencies.size() * sizeof(Bundle::Dependency);
+	header.stringsSize = strings.size();
+
+	std::vector<uint8_t> out;
+	out.reserve(header.stringsOffset + header.stringsSize);
+	Append(out, header);
+	for (const auto &entry : entries)
+		Append(out, entry);
+	for (const auto &dependency : dependencies)
+		Append(out, dependency);
+	out.insert(out.end(), strings.begin(), strings.end());
+
+	// Renamed into place, so processes attaching meanwhile see either the old index or the complete new one.
+	// The temporary name is unique per process and build, so concurrent builders never write into each other's file.
+	static std::atomic<uint32_t> buildCount = 0;
+	const auto tempName = indexName + '.' + std::to_string(detail::ProcessID()) + '.' + std::to_string(buildCount++) + ".tmp";
+	std::ofstream f(tempName, std::ios::out | std::ios::binary);
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+	f.close();
+
+	std::error_code error;
+	if (!f.fail())
+		fs::rename(tempName, indexName, error);
+	if (f.fail() || error)
+	{
+		fs::remove(tempName, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool SharedIndex::Open(const std::string &indexName, const std::string &bundleName)
+{
+	Close();
+
+	auto index = std::make_unique<detail::MappedFile>();
+	if (!index->Open(indexName) || index->GetSize() < sizeof(Header))
+		return false;
+
+	const auto &header = *reinterpret_cast<const Header *>(index->GetData());
+	if (std::memcmp(header.magic, "bndi", 4) != 0 || header.version != FileVersion)
+		return false;
+
+	if (header.entriesOffset != sizeof(Header)
+		|| header.dependenciesOffset != header.entriesOffset + static_cast<uint64_t>(header.numEntries) * sizeof(Entry)
+		|| header.stringsOffset != header.dependenciesOffset + static_cast<uint64_t>(header.numDependencies) * sizeof(Bundle::Dependency)
+		|| header.stringsOffset + header.stringsSize != index->GetSize()
+		|| (header.stringsSize > 0 && index->GetData()[index->GetSize() - 1] != '\0'))
+		return false;
+
+	uint64_t bundleSize;
+	int64_t bundleTime;
+	if (!GetFileIdentity(bundleName, bundleSize, bundleTime) || bundleSize != header.bundleSize || bundleTime != header.bundleTime)
+		return false;
+
+	auto bundle = std::make_unique<detail::MappedFile>();
+	if (!bundle->Open(bundleName) || bundle->GetSize() != header.bundleSize)
+		return false;
+
+	// Everything later reads is checked once here, so lookups can trust the index.
+	const auto *entries = reinterpret_cast<const Entry *>(index->GetData() + header.entriesOffset);
+	for (auto i = 0U; i < header.numEntries; i++)
+	{
+		const auto &entry = entries[i];
+		if ((i > 0 && entries[i - 1].resourceID >= entry.resourceID)
+			|| static_cast<uint64_t>(entry.firstDependency) + entry.numberOfDependencies > header.numDependencies
+			|| (entry.nameOffset != NoDebugInfo && (entry.nameOffset >= header.stringsSize || entry.typeNameOffset >= header.stringsSize)))
+			return false;
+
+		for (const auto &block : entry.blocks)
+		{
+			if (block.offset + block.storedSize > header.bundleSize)
+				return false;
+		}
+	}
+
+	m_index = std::move(index);
+	m_bundle = std::move(bundle);
+	return true;
+}
+
+void SharedIndex::Close()
+{
+	m_index.reset();
+	m_bundle.reset();
+}
+
+const SharedIndex::Header &SharedIndex::GetHeader() const
+{
+	return *reinterpret_cast<const Header *>(m_index->GetData());
+}
+
+const SharedIndex::Entry *SharedIndex::FindEntry(uint32_t resourceID) const
+{
+	if (m_index == nullptr)
+		return nullptr;
+
+	const auto &header = GetHeader();
+	const auto *begin = reinterpret_cast<const Entry *>(m_index->GetData() + header.entriesOffset);
+	const auto *end = begin + header.numEntries;
+	const auto *it = std::lower_bound(begin, end, resourceID, [](const Entry &entry, uint32_t id) { return entry.resourceID < id; });
+	return (it != end && it->resourceID == resourceID) ? it : nullptr;
+}
+
+Bundle::MagicVersion SharedIndex::GetMagicVersion() const
+{
+	return static_cast<Bundle::MagicVersion>(GetHeader().magicVersion);
+}
+
+uint32_t SharedIndex::GetRevisionNumber() const
+{
+	return GetHeader().revisionNumber;
+}
+
+Bundle::Platform SharedIndex::GetPlatform() const
+{
+	return static_cast<Bundle::Platform>(GetHeader().platform);
+}
+
+Bundle::Flags SharedIndex::GetFlags() const
+{
+	return static_cast<Bundle::Flags>(GetHeader().flags);
+}
+
+std::vector<uint32_t> SharedIndex::ListResourceIDs() const
+{
+	std::vector<uint32_t> resourceIDs;
+	if (m_index == nullptr)
+		return resourceIDs;
+
+	const auto &header = GetHeader();
+	const auto *entries = reinterpret_cast<const Entry *>(m_index->GetData() + header.entriesOffset);
+	resourceIDs.reserve(header.numEntries);
+	for (auto i = 0U; i < header.numEntries; i++)
+		resourceIDs.push_back(entries[i].resourceID);
+
+	return resourceIDs;
+}
+
+std::optional<Bundle::ResourceType> SharedIndex::GetResourceType(uint32_t resourceID) const
+{
+	const auto *entry = FindEntry(resourceID);
+	if (entry == nullptr)
+		return {};
+
+	return static_cast<Bundle::ResourceType>(entry->resourceType);
+}
+
+std::optional<Bundle::EntryDebugInfo> SharedIndex::GetDebugInfo(uint32_t resourceID) const
+{
+	const auto *entry = FindEntry(resourceID);
+	if (entry == nullptr || entry->nameOffset == NoDebugInfo)
+		return {};
+
+	const auto *strings = reinterpret_cast<const char *>(m_index->GetData() + GetHeader().stringsOffset);
+	return Bundle::EntryDebugInfo { strings + entry->nameOffset, strings + entry->typeNameOffset };
+}
+
+std::optional<std::vector<Bundle::Dependency>> SharedIndex::GetDependencies(uint32_t resourceID) const
+{
+	const auto *entry = FindEntry(resourceID);
+	if (entry == nullptr)
+		return {};
+
+	const auto *dependencies = reinterpret_cast<const Bundle::Dependency *>(m_index->GetData() + GetHeader().dependenciesOffset);
+	return std::vector<Bundle::Dependency>(dependencies + entry->firstDependency, dependencies + entry->firstDependency + entry->numberOfDependencies);
+}
+
+std::optional<uint32_t> SharedIndex::GetUncompressedSize(uint32_t resourceID, uint32_t fileBlock) const
+{
+	const auto *entry = FindEntry(resourceID);
+	if (entry == nullptr || fileBlock >= 3)
+		return {};
+
+	return entry->blocks[fileBlock].uncompressedSize;
+}
+
+std::optional<Bundle::DataView> SharedIndex::GetStoredData(uint32_t resourceID, uint32_t fileBlock) const
+{
+	const auto *entry = FindEntry(resourceID);
+	if (entry == nullptr || fileBlock >= 3)
+		return {};
+
+	const auto &block = entry->blocks[fileBlock];
+	if (block.storedSize == 0)
+		return Bundle::DataView();
+
+	return Bundle::DataView { m_bundle->GetData() + block.offset, block.storedSize };
+}
+
+std::unique_ptr<std::vector<uint8_t>> SharedIndex::GetBinary(uint32_t resourceID, uint32_t fileBlock) const
+{
+	const auto stored = GetStoredData(resourceID, fileBlock);
+	if (!stored || stored->data == nullptr)
+		return {};
+
+	const auto uncompressedSize = *GetUncompressedSize(resourceID, fileBlock);
+	if (!(GetFlags() & Bundle::Compressed))
+		return std::make_unique<std::vector<uint8_t>>(stored->data, stored->data + std::min<size_t>(stored->size, uncompressedSize));
+
+	auto buffer = std::make_unique<std::vector<uint8_t>>(uncompressedSize);
+	if (!detail::codec::Inflate(stored->data, stored->size, buffer->data(), buffer->size()))
+		return {};
+
+	return buffer;
+}
@@ -0,0 +1,121 @@
+#include "system.hpp"
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+using namespace libbndl::detail;
+
+uint32_t libbndl::detail::PageSize()
+{
+	static const auto pageSize = []()
+	{
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<uint32_t>(info.dwPageSize);
+#else
+		const auto size = sysconf(_SC_PAGESIZE);
+		return static_cast<uint32_t>((size > 0) ? size : 4096);
+#endif
+	}();
+	return pageSize;
+}
+
+uint32_t libbndl::detail::ProcessID()
+{
+#if defined(_WIN32)
+	return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+	return static_cast<uint32_t>(getpid());
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string &name)
+{
+	Close();
+
+#if defined(_WIN32)
+	m_file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size))
+	{
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+	if (m_size == 0)
+		return true;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping != nullptr)
+		m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	const auto fd = open(name.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	m_size = static_cast<size_t>(status.st_size);
+	if (m_size == 0)
+	{
+		close(fd);
+		return true;
+	}
+
+	auto *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps its own reference
+	if (data != MAP_FAILED)
+		m_data = static_cast<const uint8_t *>(data);
+#endif
+
+	if (m_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_data != nullptr)
+		UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr)
+		CloseHandle(m_mapping);
+	if (m_file != nullptr)
+		CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data != nullptr)
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
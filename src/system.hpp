@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libbndl::detail
+{
+	// Virtual memory page size of the running OS.
+	uint32_t PageSize();
+
+	// Identifier of the running process.
+	uint32_t ProcessID();
+
+	// Read-only memory mapping of a whole file.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+		~MappedFile();
+
+		bool Open(const std::string &name);
+		void Close();
+
+		const uint8_t *GetData() const
+		{
+			return m_data;
+		}
+
+		size_t GetSize() const
+		{
+			return m_size;
+		}
+
+	private:
+		const uint8_t *m_data = nullptr;
+		size_t m_size = 0;
+#if defined(_WIN32)
+		void *m_file = nullptr;
+		void *m_mapping = nullptr;
+#endif
+	};
+}
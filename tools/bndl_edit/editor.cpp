@@ -7,6 +7,30 @@
 #include <QSplitter>
 #include <QPixmap>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <array>
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+// Shared by the jobs of one bulk import.
+struct ImportBatch
+{
+	explicit ImportBatch(Bundle &&snapshot) : source(std::move(snapshot)) {}
+
+	const Bundle source; // resources are read from and prepared for this snapshot
+	size_t total = 0;
+	std::atomic<bool> cancelled = false;
+	QProgressDialog *progress = nullptr;
+
+	std::mutex mutex;
+	size_t finished = 0;
+	std::vector<Bundle::PreparedResource> resources;
+	QStringList errors;
+};
 
 Editor::Editor(QWidget* parent)
 {
@@ -20,14 +44,31 @@ Editor::Editor(QWidget* parent)
 	m_content = new QStackedLayout;
 	m_texteditor = new QTextEdit;
 	m_imageviewer = new QLabel;
+	m_hexpanel = new QWidget;
+	m_blockselector = new QComboBox;
+	m_hexview = new HexView(m_archive);
+	QVBoxLayout *hexlayout = new QVBoxLayout;
+	hexlayout->setContentsMargins(0, 0, 0, 0);
+	hexlayout->addWidget(m_blockselector);
+	hexlayout->addWidget(m_hexview);
+	m_hexpanel->setLayout(hexlayout);
 	m_content->addWidget(m_texteditor);
 	m_content->addWidget(m_imageviewer);
+	m_content->addWidget(m_hexpanel);
 	content->setLayout(m_content);
+	connect(m_blockselector, &QComboBox::currentIndexChanged, this, &Editor::blockChanged);
+	connect(m_hexview, &HexView::seekIndexReady, this, [this](uint32_t resourceID, uint32_t fileBlock, std::shared_ptr<const Bundle::SeekIndex> index)
+	{
+		m_archive.AddSeekIndex(resourceID, fileBlock, std::move(index));
+	});
 
 	//TREEVIEW
-	m_model = new QStandardItemModel;
+	m_model = new ResourceModel(m_archive, this);
 	treeview->setSelectionMode(QAbstractItemView::SingleSelection);
+	treeview->setUniformRowHeights(true);
 	treeview->setModel(m_model);
+	m_previewer = new Previewer(m_archive, this);
+	connect(m_previewer, &Previewer::previewReady, this, &Editor::showPreview);
 	
 	splitter->addWidget(treeview);
 	splitter->addWidget(content);
@@ -39,6 +80,7 @@ Editor::Editor(QWidget* parent)
 
 	createActions();
 	createMenus();
+	UpdateUndoActions();
 	connect(treeview->selectionModel(),
 	SIGNAL(selectionChanged(const QItemSelection&,const QItemSelection&)), 
 	this, SLOT(treeChanged(const QItemSelection&,const QItemSelection&)));
@@ -52,58 +94,150 @@ Editor::Editor(QWidget* parent)
 
 void Editor::treeChanged(const QItemSelection &selected, const QItemSelection &deselected)
 {
-	QModelIndexList indices = selected.indexes();
-	if (indices.size() > 0)
+	const auto indices = selected.indexes();
+	m_selectedResource = indices.isEmpty() ? std::nullopt : m_model->GetResourceID(indices.front());
+	if (m_selectedResource)
+		m_previewer->Request(*m_selectedResource);
+}
+
+void Editor::showPreview(uint32_t resourceID, const Preview &preview)
+{
+	// Results for resources that were selected before may still come in.
+	if (m_selectedResource != resourceID)
+		return;
+
+	if (preview.kind == Preview::Image)
+	{
+		m_imageviewer->setPixmap(QPixmap::fromImage(preview.image));
+		m_content->setCurrentWidget(m_imageviewer);
+	}
+	else if (preview.kind == Preview::Text)
 	{
-		QVariant data = indices.front().data();
-		QString entry = data.toString();
-		QString extension = entry.split('.').back();
-		/*if(extension=="ini"||extension=="inc"||extension=="txt")
+		m_texteditor->setPlainText(preview.text);
+		m_content->setCurrentWidget(m_texteditor);
+	}
+	else
+	{
+		// Changing the items selects the first block, which opens it in the hex view.
+		m_blockselector->clear();
+		for (auto i = 0U; i < 3; i++)
 		{
-			m_content->setCurrentWidget(m_texteditor);
-			std::string content = m_archive.GetText(entry.toStdString());
-			m_texteditor->setText(QString(content.c_str()));
+			const auto size = m_archive.GetUncompressedSize(resourceID, i);
+			if (size)
+				m_blockselector->addItem(tr("Block %1, %2 bytes").arg(i).arg(*size), i);
 		}
-		else if(extension=="jpg"||extension=="tga"||extension=="dds"||extension=="png")
-		{
-			m_content->setCurrentWidget(m_imageviewer);
-			size_t size = 0;
-			uint8_t* content = m_archive.GetBinary(entry.toStdString(), size);
-			QPixmap pixmap;
-			bool result = pixmap.loadFromData(content, (uint)size);
-			m_imageviewer->setPixmap(pixmap);
-		}*/
+		m_content->setCurrentWidget(m_hexpanel);
 	}
-	
 }
 
-Editor::~Editor()
+void Editor::blockChanged(int index)
 {
+	if (index < 0 || !m_selectedResource)
+	{
+		m_hexview->Clear();
+		return;
+	}
+
+	m_hexview->SetBlock(*m_selectedResource, m_blockselector->itemData(index).toUInt());
 }
 
-void Editor::Load(const std::string & archive)
+Editor::~Editor()
 {
+	if (m_loadThread != nullptr)
+	{
+		*m_loadCancelled = true;
+		m_loadThread->wait();
+	}
+
+	if (m_import != nullptr)
+		m_import->cancelled = true;
+	m_importPool.waitForDone();
+
+	if (m_saveThread != nullptr)
+		m_saveThread->wait();
 
+	// Preview and indexing jobs read m_archive, which is destroyed before the previewer and hex view are.
+	m_previewer->Reset();
+	m_hexview->Clear();
 }
 
-struct Directory
+void Editor::Load(const std::string &name)
 {
+	// An import in flight is applied to m_archive when it finishes, so it must not be swapped out meanwhile.
+	if (m_loadThread != nullptr || m_import != nullptr)
+		return;
 
-};
+	auto *progress = new QProgressDialog(tr("Loading %1...").arg(QString::fromStdString(name)), tr("Cancel"), 0, 0, this);
+	progress->setWindowModality(Qt::WindowModal);
+	progress->setMinimumDuration(500);
 
-void Editor::PopulateTree()
-{
-	//get root of the tree
-	m_model->clear();
-	QStandardItem *item = m_model->invisibleRootItem();
-	for (const auto &resourceID : m_archive.ListResourceIDs())
+	auto cancelled = std::make_shared<std::atomic<bool>>(false);
+	connect(progress, &QProgressDialog::canceled, this, [cancelled] { *cancelled = true; });
+
+	auto archive = std::make_shared<Bundle>();
+	auto loaded = std::make_shared<bool>(false);
+	m_loadThread = QThread::create([name, progress, cancelled, archive, loaded]
 	{
-		const auto info = m_archive.GetDebugInfo(resourceID);
-		const auto &name = info ? QString::fromStdString(info->name) : QString::number(resourceID, 16);
-		QStandardItem *child = new QStandardItem(name);
-		child->setData(QVariant(name));
-		item->appendRow(child);
-	}
+		const auto reportProgress = [progress, cancelled](size_t loadedEntries, size_t totalEntries)
+		{
+			// Queued to the dialog, so nothing is delivered once it is gone.
+			QMetaObject::invokeMethod(progress, [progress, loadedEntries, totalEntries]
+			{
+				progress->setMaximum(static_cast<int>(totalEntries));
+				progress->setValue(static_cast<int>(loadedEntries));
+			}, Qt::QueuedConnection);
+			return !*cancelled;
+		};
+
+		try
+		{
+			*loaded = archive->Load(name, reportProgress);
+		}
+		catch (const std::exception &)
+		{
+			*loaded = false;
+		}
+	});
+	m_loadThread->setParent(this);
+	m_loadCancelled = cancelled;
+
+	connect(m_loadThread, &QThread::finished, this, [this, name, progress, cancelled, archive, loaded]
+	{
+		m_loadThread->deleteLater();
+		m_loadThread = nullptr;
+		progress->deleteLater();
+
+		if (*cancelled)
+		{
+			statusBar()->showMessage(tr("Loading cancelled"));
+			return;
+		}
+
+		if (!*loaded)
+		{
+			QMessageBox::critical(this, tr("Error"), tr("Could not load the bundle."));
+			return;
+		}
+
+		ReplaceArchive(std::move(*archive));
+		m_path = QString::fromStdString(name);
+		m_undoStack.clear();
+		m_redoStack.clear();
+		UpdateUndoActions();
+		statusBar()->showMessage(tr("Loaded %1").arg(m_path));
+	});
+
+	m_loadThread->start();
+}
+
+void Editor::ReplaceArchive(Bundle &&archive)
+{
+	m_previewer->Reset();
+	m_hexview->Clear();
+	m_selectedResource.reset();
+	m_model->BeginReset();
+	m_archive = std::move(archive);
+	m_model->EndReset();
 }
 
 void Editor::createActions()
@@ -124,6 +258,10 @@ void Editor::createActions()
 	createAction(saveAct, QKeySequence::Save, "&Save", "Save opened archive", &Editor::save);
 	//SAVE AS
 	createAction(saveAsAct, QKeySequence::SaveAs, "Save &As...", "Save opened archive", &Editor::saveAs);
+	//IMPORT
+	importAct = new QAction(tr("&Import Folder..."), this);
+	importAct->setStatusTip(tr("Replace resources with the files of a folder"));
+	connect(importAct, &QAction::triggered, this, &Editor::importFolder);
 	//QUIT
 	createAction(quitAct, QKeySequence::Quit, "&Quit", "Quit program", &Editor::quit);
 	//UNDO
@@ -154,6 +292,8 @@ void Editor::createMenus()
 	fileMenu->addAction(saveAct);
 	fileMenu->addAction(saveAsAct);
 	fileMenu->addSeparator();
+	fileMenu->addAction(importAct);
+	fileMenu->addSeparator();
 	fileMenu->addAction(quitAct);
 
 	editMenu = menuBar()->addMenu(tr("&Edit"));
@@ -192,20 +332,22 @@ void Editor::open()
 
 	if (fileName == nullptr)
 		return;
-	
-	if (m_archive.Load(fileName.toStdString()))
-	{
-		m_path = fileName;
-		PopulateTree();
-	}
-	else
+
+	Load(fileName.toStdString());
+}
+
+void Editor::save()
+{
+	if (m_path.isEmpty())
 	{
-		QMessageBox messageBox;
-		messageBox.critical(0, "Error", "Could not load the bundle.");
+		saveAs();
+		return;
 	}
+
+	SaveTo(m_path);
 }
 
-void Editor::save()
+void Editor::saveAs()
 {
 	auto fileName = QFileDialog::getSaveFileName(this,
     tr("Save Archive"), "", tr("BUNDLE Files (*.BUNDLE; *.BNDL; *.BIN; *.DAT; *.TEX; *.FONT)"));
@@ -213,19 +355,249 @@ void Editor::save()
 	if (fileName == nullptr)
 		return;
 
-	m_archive.Save(fileName.toStdString());
+	SaveTo(fileName);
 }
 
-void Editor::saveAs()
+void Editor::SaveTo(const QString &path)
+{
+	if (m_saveThread != nullptr)
+		return;
+
+	// Written next to the target and renamed over it, so a failed save leaves the old file as it was.
+	auto snapshot = std::make_shared<Bundle>(m_archive.Snapshot());
+	auto saved = std::make_shared<bool>(false);
+	const auto name = path.toStdString();
+	m_saveThread = QThread::create([snapshot, saved, name]
+	{
+		const auto temporaryName = name + ".tmp";
+		std::error_code error;
+		try
+		{
+			*saved = snapshot->Save(temporaryName);
+		}
+		catch (const std::exception &)
+		{
+			*saved = false;
+		}
+
+		if (*saved)
+		{
+			std::filesystem::rename(temporaryName, name, error);
+			*saved = !error;
+		}
+
+		if (!*saved)
+			std::filesystem::remove(temporaryName, error);
+	});
+	m_saveThread->setParent(this);
+	saveAct->setEnabled(false);
+	saveAsAct->setEnabled(false);
+	statusBar()->showMessage(tr("Saving %1...").arg(path));
+
+	connect(m_saveThread, &QThread::finished, this, [this, path, saved]
+	{
+		m_saveThread->deleteLater();
+		m_saveThread = nullptr;
+		saveAct->setEnabled(true);
+		saveAsAct->setEnabled(true);
+
+		if (!*saved)
+		{
+			QMessageBox::critical(this, tr("Error"), tr("Could not save the bundle."));
+			return;
+		}
+
+		m_path = path;
+		statusBar()->showMessage(tr("Saved %1").arg(path));
+	});
+
+	m_saveThread->start();
+}
+
+void Editor::importFolder()
+{
+	if (m_loadThread != nullptr || m_import != nullptr)
+		return;
+
+	const auto directory = QFileDialog::getExistingDirectory(this, tr("Import Folder"));
+	if (directory.isEmpty())
+		return;
+
+	// Files are named after the ID of the resource they replace, in hex, or its debug name, optionally followed
+	// by _0, _1 or _2 for the block; block 0 otherwise. Extensions are ignored.
+	std::map<QString, uint32_t> names;
+	for (const auto &resource : m_archive.GetResources())
+	{
+		if (resource.debugInfo != nullptr)
+			names.emplace(QString::fromStdString(resource.debugInfo->name).toLower(), resource.resourceID);
+	}
+
+	std::map<uint32_t, std::array<QString, 3>> files;
+	size_t skippedFiles = 0;
+	for (const auto &file : QDir(directory).entryInfoList(QDir::Files))
+	{
+		auto name = file.completeBaseName().toLower();
+		auto block = 0;
+		if (name.size() > 2 && name.at(name.size() - 2) == '_' && name.at(name.size() - 1) >= '0' && name.at(name.size() - 1) <= '2')
+		{
+			block = name.at(name.size() - 1).digitValue();
+			name.chop(2);
+		}
+
+		auto found = false;
+		auto resourceID = name.size() == 8 ? name.toUInt(&found, 16) : 0U;
+		if (!found)
+		{
+			const auto it = names.find(name);
+			found = it != names.end();
+			resourceID = found ? it->second : 0;
+		}
+
+		if (!found || !m_archive.GetResourceType(resourceID))
+		{
+			skippedFiles++;
+			continue;
+		}
+
+		files[resourceID][block] = file.absoluteFilePath();
+	}
+
+	if (files.empty())
+	{
+		QMessageBox::information(this, tr("Import Folder"), tr("No file in the folder is named after a resource of this bundle."));
+		return;
+	}
+
+	auto batch = std::make_shared<ImportBatch>(m_archive.Snapshot());
+	batch->total = files.size();
+	batch->progress = new QProgressDialog(tr("Importing %1 resources...").arg(files.size()), tr("Cancel"), 0, static_cast<int>(files.size()), this);
+	batch->progress->setMinimumDuration(500);
+	connect(batch->progress, &QProgressDialog::canceled, this, [batch] { batch->cancelled = true; });
+
+	m_import = batch;
+	importAct->setEnabled(false);
+	openAct->setEnabled(false);
+	UpdateUndoActions();
+
+	for (const auto &file : files)
+	{
+		m_importPool.start([this, batch, skippedFiles, resourceID = file.first, paths = file.second]
+		{
+			std::optional<Bundle::PreparedResource> prepared;
+			QString error;
+			if (!batch->cancelled)
+			{
+				// Blocks without a file, and the imports, are kept.
+				auto data = batch->source.GetData(resourceID);
+				for (auto i = 0U; data && i < 3 && error.isEmpty(); i++)
+				{
+					if (paths[i].isEmpty())
+						continue;
+
+					QFile input(paths[i]);
+					if (!input.open(QIODevice::ReadOnly))
+					{
+						error = tr("Could not read %1.").arg(paths[i]);
+						continue;
+					}
+
+					const auto bytes = input.readAll();
+					data->fileBlockData[i] = std::make_unique<std::vector<uint8_t>>(bytes.begin(), bytes.end());
+				}
+
+				if (data && error.isEmpty())
+					prepared = batch->source.PrepareResource(resourceID, *data);
+				if (!prepared && error.isEmpty())
+					error = tr("Could not import resource %1.").arg(resourceID, 8, 16, QChar('0'));
+			}
+
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			if (prepared)
+				batch->resources.push_back(std::move(*prepared));
+			else if (!error.isEmpty())
+				batch->errors.push_back(error);
+
+			// Posted under the lock so progress arrives in order. The editor waits for the pool before it is
+			// destroyed, and anything still queued is dropped with it.
+			const auto finished = ++batch->finished;
+			QMetaObject::invokeMethod(this, [this, batch, finished, skippedFiles]
+			{
+				batch->progress->setValue(static_cast<int>(finished));
+				if (finished == batch->total)
+					FinishImport(batch, skippedFiles);
+			}, Qt::QueuedConnection);
+		});
+	}
+}
+
+void Editor::FinishImport(const std::shared_ptr<ImportBatch> &batch, size_t skippedFiles)
 {
+	batch->progress->deleteLater();
+	m_import.reset();
+	importAct->setEnabled(true);
+	openAct->setEnabled(true);
+	UpdateUndoActions();
+
+	if (batch->cancelled)
+	{
+		statusBar()->showMessage(tr("Import cancelled"));
+		return;
+	}
+
+	// Nothing is applied unless every file could be imported.
+	if (!batch->errors.isEmpty())
+	{
+		QMessageBox::critical(this, tr("Error"), batch->errors.join('\n'));
+		return;
+	}
+
+	auto archive = m_archive.Snapshot();
+	if (!archive.ReplaceResources(std::move(batch->resources)))
+	{
+		QMessageBox::critical(this, tr("Error"), tr("Could not apply the imported resources."));
+		return;
+	}
+
+	RecordUndo();
+	ReplaceArchive(std::move(archive));
+	statusBar()->showMessage(tr("Imported %1 resources, skipped %2 files").arg(batch->total).arg(skippedFiles));
+}
+
+void Editor::RecordUndo()
+{
+	m_undoStack.push_back(m_archive.Snapshot());
+	if (m_undoStack.size() > MaxUndoSteps)
+		m_undoStack.erase(m_undoStack.begin());
+	m_redoStack.clear();
+	UpdateUndoActions();
+}
+
+void Editor::UpdateUndoActions()
+{
+	undoAct->setEnabled(!m_undoStack.empty() && m_import == nullptr);
+	redoAct->setEnabled(!m_redoStack.empty() && m_import == nullptr);
 }
 
 void Editor::undo()
 {
+	if (m_undoStack.empty() || m_import != nullptr)
+		return;
+
+	m_redoStack.push_back(m_archive.Snapshot());
+	ReplaceArchive(std::move(m_undoStack.back()));
+	m_undoStack.pop_back();
+	UpdateUndoActions();
 }
 
 void Editor::redo()
 {
+	if (m_redoStack.empty() || m_import != nullptr)
+		return;
+
+	m_undoStack.push_back(m_archive.Snapshot());
+	ReplaceArchive(std::move(m_redoStack.back()));
+	m_redoStack.pop_back();
+	UpdateUndoActions();
 }
 
 void Editor::cut()
@@ -2,14 +2,25 @@
 #include <QMainWindow>
 #include <QTreeView>
 #include <QAction>
-#include <QStandardItemModel>
+#include <QThread>
+#include <QThreadPool>
 #include <QStackedLayout>
 #include <QLabel>
+#include <QComboBox>
 #include <QTextEdit>
 #include <libbndl/bundle.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <optional>
+#include "hexview.hpp"
+#include "previewer.hpp"
+#include "resourcemodel.hpp"
 
 using namespace libbndl;
 
+struct ImportBatch;
+
 class Editor : public QMainWindow
 {
 	Q_OBJECT
@@ -25,10 +36,13 @@ protected:
 #endif // QT_NO_CONTEXTMENU
 private slots:
 	void treeChanged(const QItemSelection &selected, const QItemSelection &deselected);
+	void showPreview(uint32_t resourceID, const Preview &preview);
+	void blockChanged(int index);
 	void newFile();
 	void open();
 	void save();
 	void saveAs();
+	void importFolder();
 	void undo();
 	void redo();
 	void cut();
@@ -50,6 +64,7 @@ private:
 	QAction *openAct;
 	QAction *saveAct;
 	QAction *saveAsAct;
+	QAction *importAct;
 	QAction *quitAct;
 	QAction *undoAct;
 	QAction *redoAct;
@@ -59,12 +74,34 @@ private:
 	QAction *aboutAct;
 	QAction *aboutQtAct;
 private:
-	void PopulateTree();
+	void ReplaceArchive(Bundle &&archive);
+	void SaveTo(const QString &path);
+	void FinishImport(const std::shared_ptr<ImportBatch> &batch, size_t skippedFiles);
+	// Call before changing m_archive.
+	void RecordUndo();
+	void UpdateUndoActions();
 private:
 	QTextEdit* m_texteditor;
 	QLabel* m_imageviewer;
+	QWidget* m_hexpanel;
+	QComboBox* m_blockselector;
+	HexView* m_hexview;
 	QStackedLayout* m_content;
-	QStandardItemModel* m_model;
+	ResourceModel* m_model;
+	Previewer* m_previewer;
+	std::optional<uint32_t> m_selectedResource;
 	QString m_path;
 	Bundle m_archive;
+	// Bundles are loaded on a worker thread into a bundle of their own, then swapped in.
+	QThread* m_loadThread = nullptr;
+	std::shared_ptr<std::atomic<bool>> m_loadCancelled;
+	// Saving writes a snapshot, so the bundle can still be edited meanwhile.
+	QThread* m_saveThread = nullptr;
+	// Imported files are compressed on the pool and only applied once every one of them is ready.
+	QThreadPool m_importPool;
+	std::shared_ptr<ImportBatch> m_import;
+	// Snapshots share resource data with m_archive, so a step only costs its entry tables.
+	std::vector<Bundle> m_undoStack;
+	std::vector<Bundle> m_redoStack;
+	static constexpr size_t MaxUndoSteps = 100;
 };
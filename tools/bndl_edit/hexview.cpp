@@ -0,0 +1,260 @@
+#include "hexview.hpp"
+#include <QFontDatabase>
+#include <QHelpEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QToolTip>
+#include <algorithm>
+#include <climits>
+
+namespace
+{
+	// Translucent, so they read on light and dark palettes alike.
+	const QColor ImportIDColor(255, 200, 0, 96);
+	const QColor ImportOffsetColor(0, 140, 255, 96);
+	const QColor PointerColor(0, 200, 80, 96);
+
+	// Pointers are 32 bits on every platform the games shipped on.
+	constexpr uint64_t PointerSize = 4;
+
+	QString ToHex(uint64_t value, int width)
+	{
+		return QString::number(value, 16).rightJustified(width, '0');
+	}
+}
+
+HexView::HexView(const Bundle &bundle, QWidget *parent)
+	: QAbstractScrollArea(parent), m_bundle(bundle), m_pages(MaxPages)
+{
+	setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+	verticalScrollBar()->setSingleStep(1);
+	m_indexPool.setMaxThreadCount(1);
+}
+
+HexView::~HexView()
+{
+	Clear();
+}
+
+void HexView::SetBlock(uint32_t resourceID, uint32_t fileBlock)
+{
+	Clear();
+
+	m_resourceID = resourceID;
+	m_fileBlock = fileBlock;
+	m_size = m_bundle.GetUncompressedSize(resourceID, fileBlock).value_or(0);
+	ReadFields();
+
+	verticalScrollBar()->setValue(0);
+	horizontalScrollBar()->setValue(0);
+	UpdateScrollBars();
+
+	if (m_size >= MinimumIndexedSize && !m_bundle.HasSeekIndex(resourceID, fileBlock))
+		BuildSeekIndex();
+}
+
+void HexView::Clear()
+{
+	if (m_indexCancelled != nullptr)
+		*m_indexCancelled = true;
+	m_indexPool.waitForDone();
+	m_indexCancelled.reset();
+	++m_generation;
+
+	m_resourceID.reset();
+	m_size = 0;
+	m_fields.clear();
+	m_pages.clear();
+	UpdateScrollBars();
+	viewport()->update();
+}
+
+void HexView::ReadFields()
+{
+	if (m_fileBlock != 0)
+		return;
+
+	const auto info = m_bundle.GetEntryInfo(*m_resourceID);
+	const auto dependencies = m_bundle.GetDependencies(*m_resourceID);
+	if (!info || !dependencies)
+		return;
+
+	const auto describe = [this](uint32_t resourceID)
+	{
+		const auto debugInfo = m_bundle.GetDebugInfo(resourceID);
+		const auto id = ToHex(resourceID, 8);
+		return debugInfo ? QString("%1 (%2)").arg(id, QString::fromStdString(debugInfo->name)) : id;
+	};
+
+	// BNDL keeps imports outside of the resource's blocks, BND2 appends them to block 0.
+	const auto hasTable = m_bundle.GetMagicVersion() == Bundle::BND2;
+	for (size_t i = 0; i < dependencies->size(); i++)
+	{
+		const auto &dependency = (*dependencies)[i];
+		if (hasTable)
+		{
+			const uint64_t record = info->dependenciesOffset + i * 16;
+			m_fields.push_back({ record, record + 8, ImportIDColor, tr("Import %1: %2").arg(i).arg(describe(dependency.resourceID)) });
+			m_fields.push_back({ record + 8, record + 12, ImportOffsetColor, tr("Import %1: patches offset %2").arg(i).arg(ToHex(dependency.internalOffset, 8)) });
+		}
+		m_fields.push_back({ dependency.internalOffset, dependency.internalOffset + PointerSize, PointerColor, tr("Pointer to import %1: %2").arg(i).arg(describe(dependency.resourceID)) });
+	}
+
+	std::sort(m_fields.begin(), m_fields.end(), [](const Field &a, const Field &b) { return a.begin < b.begin; });
+}
+
+void HexView::BuildSeekIndex()
+{
+	auto cancelled = std::make_shared<std::atomic<bool>>(false);
+	m_indexCancelled = cancelled;
+	m_indexPool.start([this, cancelled, generation = m_generation, resourceID = *m_resourceID, fileBlock = m_fileBlock]
+	{
+		auto index = m_bundle.BuildBlockSeekIndex(resourceID, fileBlock, cancelled.get());
+		if (index == nullptr)
+			return;
+
+		QMetaObject::invokeMethod(this, [this, generation, resourceID, fileBlock, index]
+		{
+			if (generation == m_generation)
+				emit seekIndexReady(resourceID, fileBlock, index);
+		}, Qt::QueuedConnection);
+	});
+}
+
+const HexView::Field *HexView::FindField(uint64_t offset) const
+{
+	auto it = std::upper_bound(m_fields.begin(), m_fields.end(), offset, [](uint64_t value, const Field &field) { return value < field.begin; });
+	if (it == m_fields.begin())
+		return nullptr;
+
+	--it;
+	return offset < it->end ? &*it : nullptr;
+}
+
+const QByteArray *HexView::GetPage(uint64_t page)
+{
+	if (const auto *cached = m_pages.object(page))
+		return cached;
+
+	// Failed reads are cached too, so they are not retried on every repaint.
+	auto *data = new QByteArray;
+	if (const auto range = m_bundle.ReadRange(*m_resourceID, m_fileBlock, page * PageSize, PageSize))
+		*data = QByteArray(reinterpret_cast<const char *>(range->data()), static_cast<qsizetype>(range->size()));
+
+	m_pages.insert(page, data);
+	return data;
+}
+
+void HexView::UpdateScrollBars()
+{
+	const auto rowHeight = fontMetrics().height();
+	const auto visibleRows = std::max(1, viewport()->height() / rowHeight);
+	const auto rows = static_cast<int>(std::min<uint64_t>((m_size + BytesPerRow - 1) / BytesPerRow, INT_MAX));
+	verticalScrollBar()->setRange(0, std::max(0, rows - visibleRows));
+	verticalScrollBar()->setPageStep(visibleRows);
+
+	const auto width = RowLength * fontMetrics().horizontalAdvance(QLatin1Char('0'));
+	horizontalScrollBar()->setRange(0, std::max(0, width - viewport()->width()));
+	horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+void HexView::resizeEvent(QResizeEvent *event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	UpdateScrollBars();
+}
+
+void HexView::paintEvent(QPaintEvent *event)
+{
+	Q_UNUSED(event);
+
+	QPainter painter(viewport());
+	if (!m_resourceID)
+		return;
+
+	const auto metrics = fontMetrics();
+	const auto rowHeight = metrics.height();
+	const auto charWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+	const auto left = -horizontalScrollBar()->value();
+	const auto firstRow = static_cast<uint64_t>(verticalScrollBar()->value());
+	painter.setPen(palette().color(QPalette::Text));
+
+	for (auto y = 0; y < viewport()->height(); y += rowHeight)
+	{
+		const auto rowOffset = (firstRow + y / rowHeight) * BytesPerRow;
+		if (rowOffset >= m_size)
+			break;
+
+		const auto page = rowOffset / PageSize;
+		const auto *data = GetPage(page);
+		const auto pageOffset = rowOffset - page * PageSize;
+
+		QString hex;
+		QString text;
+		for (uint64_t i = 0; i < BytesPerRow; i++)
+		{
+			const auto offset = rowOffset + i;
+			if (offset >= m_size)
+				break;
+
+			if (const auto *field = FindField(offset))
+			{
+				const auto x = left + (HexColumn + static_cast<int>(i) * 3) * charWidth;
+				painter.fillRect(x, y, charWidth * 3, rowHeight, field->color);
+				painter.fillRect(left + (TextColumn + static_cast<int>(i)) * charWidth, y, charWidth, rowHeight, field->color);
+			}
+
+			if (pageOffset + i >= static_cast<uint64_t>(data->size()))
+			{
+				hex += "?? ";
+				text += '?';
+				continue;
+			}
+
+			const auto byte = static_cast<uint8_t>(data->at(static_cast<qsizetype>(pageOffset + i)));
+			hex += ToHex(byte, 2) + ' ';
+			text += (byte >= 0x20 && byte < 0x7F) ? QChar(static_cast<ushort>(byte)) : QChar('.');
+		}
+
+		const auto baseline = y + metrics.ascent();
+		painter.drawText(left, baseline, ToHex(rowOffset, 8));
+		painter.drawText(left + HexColumn * charWidth, baseline, hex);
+		painter.drawText(left + TextColumn * charWidth, baseline, text);
+	}
+}
+
+std::optional<uint64_t> HexView::OffsetAt(const QPoint &position) const
+{
+	const auto charWidth = fontMetrics().horizontalAdvance(QLatin1Char('0'));
+	const auto row = static_cast<uint64_t>(verticalScrollBar()->value()) + position.y() / fontMetrics().height();
+	const auto column = (position.x() + horizontalScrollBar()->value()) / charWidth;
+
+	int byte;
+	if (column >= HexColumn && column < TextColumn - 1)
+		byte = (column - HexColumn) / 3;
+	else if (column >= TextColumn && column < RowLength)
+		byte = column - TextColumn;
+	else
+		return {};
+
+	const auto offset = row * BytesPerRow + byte;
+	if (position.y() < 0 || offset >= m_size)
+		return {};
+
+	return offset;
+}
+
+bool HexView::viewportEvent(QEvent *event)
+{
+	if (event->type() != QEvent::ToolTip)
+		return QAbstractScrollArea::viewportEvent(event);
+
+	const auto *helpEvent = static_cast<QHelpEvent *>(event);
+	const auto offset = OffsetAt(helpEvent->pos());
+	const auto *field = offset ? FindField(*offset) : nullptr;
+	if (field != nullptr)
+		QToolTip::showText(helpEvent->globalPos(), QString("%1: %2").arg(ToHex(*offset, 8), field->description), viewport());
+	else
+		QToolTip::hideText();
+	return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QCache>
+#include <QColor>
+#include <QString>
+#include <QThreadPool>
+#include <libbndl/bundle.hpp>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace libbndl;
+
+// Hex dump of a single block that only reads and paints the rows on screen, so a block of hundreds of megabytes
+// opens as fast as a small one. Large compressed blocks are indexed in the background when they are opened, so
+// rows deep into them do not have to be inflated from the start. Block 0 is overlaid with its import table and
+// the pointers the imports patch.
+class HexView : public QAbstractScrollArea
+{
+	Q_OBJECT
+
+public:
+	explicit HexView(const Bundle &bundle, QWidget *parent = nullptr);
+	~HexView();
+
+	void SetBlock(uint32_t resourceID, uint32_t fileBlock);
+	// Forgets the block and every row read from it, and stops indexing it. Call before the bundle is changed.
+	void Clear();
+
+signals:
+	// The bundle is only read here; whoever owns it may add the index.
+	void seekIndexReady(uint32_t resourceID, uint32_t fileBlock, std::shared_ptr<const Bundle::SeekIndex> index);
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
+	bool viewportEvent(QEvent *event) override;
+
+private:
+	struct Field
+	{
+		uint64_t begin;
+		uint64_t end;
+		QColor color;
+		QString description;
+	};
+
+	void ReadFields();
+	void BuildSeekIndex();
+	void UpdateScrollBars();
+	// Valid until the next call.
+	const QByteArray *GetPage(uint64_t page);
+	const Field *FindField(uint64_t offset) const;
+	std::optional<uint64_t> OffsetAt(const QPoint &position) const;
+
+	static constexpr uint64_t BytesPerRow = 16;
+	// Rows are read a page at a time; a page holds a whole number of rows.
+	static constexpr uint64_t PageSize = 0x10000;
+	static constexpr int MaxPages = 16;
+	// Smaller blocks inflate quickly enough from the start.
+	static constexpr uint64_t MinimumIndexedSize = 4 << 20;
+	// Characters before the hex and text columns of a row.
+	static constexpr int HexColumn = 10;
+	static constexpr int TextColumn = HexColumn + static_cast<int>(BytesPerRow) * 3 + 1;
+	static constexpr int RowLength = TextColumn + static_cast<int>(BytesPerRow);
+
+	const Bundle &m_bundle;
+	std::optional<uint32_t> m_resourceID;
+	uint32_t m_fileBlock = 0;
+	uint64_t m_size = 0;
+	std::vector<Field> m_fields; // sorted by begin
+	QCache<uint64_t, QByteArray> m_pages;
+	QThreadPool m_indexPool;
+	std::shared_ptr<std::atomic<bool>> m_indexCancelled;
+	uint64_t m_generation = 0; // bumped by Clear, so indexes of blocks that are gone are dropped
+};
@@ -18,5 +18,9 @@ int main(int argc,char** argv)
 	Editor window;
 	window.show();
 
+	const auto files = parser.positionalArguments();
+	if (!files.isEmpty())
+		window.Load(files.first().toStdString());
+
 	return app.exec();
 }
\ No newline at end of file
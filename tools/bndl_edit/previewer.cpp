@@ -0,0 +1,127 @@
+#include "previewer.hpp"
+#include <cstring>
+
+namespace
+{
+	// Enough to recognise a file format.
+	constexpr size_t SniffSize = 0x1000;
+	constexpr size_t MaxTextSize = 0x100000;
+	constexpr int CacheSizeKB = 64 * 1024;
+
+	bool IsImage(const Bundle::DataView &view)
+	{
+		static const std::pair<const char *, size_t> signatures[] = {
+			{ "\x89PNG", 4 },
+			{ "\xFF\xD8\xFF", 3 },
+			{ "DDS ", 4 },
+			{ "BM", 2 },
+		};
+
+		for (const auto &signature : signatures)
+		{
+			if (view.size >= signature.second && std::memcmp(view.data, signature.first, signature.second) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+Previewer::Previewer(const Bundle &bundle, QObject *parent)
+	: QObject(parent), m_bundle(bundle), m_cache(CacheSizeKB)
+{
+	m_pool.setMaxThreadCount(2);
+}
+
+Previewer::~Previewer()
+{
+	Reset();
+}
+
+void Previewer::Request(uint32_t resourceID)
+{
+	const auto generation = ++m_generation;
+	m_pool.clear();
+
+	if (const auto *cached = m_cache.object(resourceID))
+	{
+		emit previewReady(resourceID, *cached);
+		return;
+	}
+
+	m_pool.start([this, resourceID, generation]
+	{
+		auto result = Decode(resourceID, generation);
+		if (!result)
+			return;
+
+		QMetaObject::invokeMethod(this, [this, resourceID, generation, preview = std::move(*result)]
+		{
+			// Jobs that finish while Reset waits for them post results decoded from the old bundle.
+			if (!IsCurrent(generation))
+				return;
+
+			const auto cost = static_cast<int>((preview.image.sizeInBytes() + preview.text.size() * sizeof(QChar)) / 1024 + 1);
+			m_cache.insert(resourceID, new Preview(preview), cost);
+			emit previewReady(resourceID, preview);
+		}, Qt::QueuedConnection);
+	});
+}
+
+void Previewer::Reset()
+{
+	++m_generation;
+	m_pool.clear();
+	m_pool.waitForDone();
+	m_cache.clear();
+}
+
+std::optional<Preview> Previewer::Decode(uint32_t resourceID, uint64_t generation) const
+{
+	// Only prefixes are inflated until we know what the resource is.
+	std::vector<uint8_t> scratch[3];
+	Bundle::DataView heads[3];
+	for (auto i = 0U; i < 3; i++)
+	{
+		if (!IsCurrent(generation))
+			return {};
+
+		const auto head = m_bundle.ReadPrefix(resourceID, i, SniffSize, scratch[i]);
+		if (head)
+			heads[i] = *head;
+	}
+
+	Preview preview;
+	const auto type = m_bundle.GetResourceType(resourceID);
+	if (type == Bundle::TextFile || type == Bundle::LuaCode)
+	{
+		std::vector<uint8_t> text(heads[0].data, heads[0].data + heads[0].size);
+		if (m_bundle.GetUncompressedSize(resourceID, 0).value_or(0) > SniffSize && IsCurrent(generation))
+		{
+			auto longer = m_bundle.ReadPrefix(resourceID, 0, MaxTextSize);
+			if (longer != nullptr)
+				text = std::move(*longer);
+		}
+
+		preview.kind = Preview::Text;
+		preview.text = QString::fromUtf8(reinterpret_cast<const char *>(text.data()), static_cast<qsizetype>(text.size()));
+		return preview;
+	}
+
+	for (auto i = 0U; i < 3; i++)
+	{
+		if (heads[i].data == nullptr || !IsImage(heads[i]))
+			continue;
+
+		if (!IsCurrent(generation))
+			return {};
+
+		const auto block = m_bundle.GetBinary(resourceID, i);
+		if (block != nullptr && preview.image.loadFromData(block->data(), static_cast<int>(block->size())))
+		{
+			preview.kind = Preview::Image;
+			return preview;
+		}
+	}
+
+	return preview;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <libbndl/bundle.hpp>
+#include <atomic>
+#include <optional>
+
+using namespace libbndl;
+
+struct Preview
+{
+	enum Kind
+	{
+		Text,
+		Image,
+		HexDump // anything that cannot be decoded, shown in the hex view
+	};
+
+	Kind kind = HexDump;
+	QString text;
+	QImage image;
+};
+
+// Fetches and decodes resources on a thread pool. Only the latest request matters: queued jobs are dropped
+// and running ones give up at their next check as soon as another resource is requested.
+class Previewer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit Previewer(const Bundle &bundle, QObject *parent = nullptr);
+	~Previewer();
+
+	// previewReady is emitted on the calling thread, right away if the preview is cached.
+	void Request(uint32_t resourceID);
+	// Cancels and waits for all jobs, and empties the cache. Call before the bundle is changed.
+	void Reset();
+
+signals:
+	void previewReady(uint32_t resourceID, const Preview &preview);
+
+private:
+	std::optional<Preview> Decode(uint32_t resourceID, uint64_t generation) const;
+	bool IsCurrent(uint64_t generation) const
+	{
+		return m_generation == generation;
+	}
+
+	const Bundle &m_bundle;
+	QThreadPool m_pool;
+	std::atomic<uint64_t> m_generation = 0;
+	QCache<uint32_t, Preview> m_cache; // UI thread only, cost in KB
+};
@@ -0,0 +1,107 @@
+#include "resourcemodel.hpp"
+
+ResourceModel::ResourceModel(const Bundle &bundle, QObject *parent)
+	: QAbstractItemModel(parent), m_bundle(bundle)
+{
+	ReadIndex();
+}
+
+void ResourceModel::BeginReset()
+{
+	beginResetModel();
+	m_types.clear();
+	m_resourceIDs.clear();
+}
+
+void ResourceModel::EndReset()
+{
+	ReadIndex();
+	endResetModel();
+}
+
+void ResourceModel::ReadIndex()
+{
+	m_types = m_bundle.ListResourceTypes();
+	for (const auto resourceType : m_types)
+		m_resourceIDs.push_back(m_bundle.GetResourceIDs(resourceType));
+}
+
+std::optional<uint32_t> ResourceModel::GetResourceID(const QModelIndex &index) const
+{
+	if (!index.isValid() || index.internalId() == TypeRow)
+		return {};
+
+	return m_resourceIDs[index.internalId() - 1].begin()[index.row()];
+}
+
+QModelIndex ResourceModel::index(int row, int column, const QModelIndex &parent) const
+{
+	if (!hasIndex(row, column, parent))
+		return {};
+
+	if (!parent.isValid())
+		return createIndex(row, column, TypeRow);
+
+	return createIndex(row, column, static_cast<quintptr>(parent.row()) + 1);
+}
+
+QModelIndex ResourceModel::parent(const QModelIndex &child) const
+{
+	if (!child.isValid() || child.internalId() == TypeRow)
+		return {};
+
+	return createIndex(static_cast<int>(child.internalId() - 1), 0, TypeRow);
+}
+
+int ResourceModel::rowCount(const QModelIndex &parent) const
+{
+	if (!parent.isValid())
+		return static_cast<int>(m_types.size());
+
+	if (parent.internalId() == TypeRow && parent.column() == 0)
+		return static_cast<int>(m_resourceIDs[parent.row()].size());
+
+	return 0;
+}
+
+int ResourceModel::columnCount(const QModelIndex &) const
+{
+	return ColumnCount;
+}
+
+QVariant ResourceModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || role != Qt::DisplayRole)
+		return {};
+
+	if (index.internalId() == TypeRow)
+	{
+		if (index.column() != NameColumn)
+			return {};
+
+		const auto count = m_resourceIDs[index.row()].size();
+		return tr("Type 0x%1 (%2)").arg(static_cast<uint32_t>(m_types[index.row()]), 0, 16).arg(count);
+	}
+
+	const auto resourceID = *GetResourceID(index);
+	if (index.column() == NameColumn)
+	{
+		const auto debugInfo = m_bundle.GetDebugInfo(resourceID);
+		if (debugInfo)
+			return QString::fromStdString(debugInfo->name);
+		return QString::number(resourceID, 16).rightJustified(8, '0');
+	}
+
+	qulonglong size = 0;
+	for (auto i = 0U; i < 3; i++)
+		size += m_bundle.GetUncompressedSize(resourceID, i).value_or(0);
+	return size;
+}
+
+QVariant ResourceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return {};
+
+	return (section == NameColumn) ? tr("Name") : tr("Size");
+}
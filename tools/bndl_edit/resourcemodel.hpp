@@ -0,0 +1,46 @@
+#pragma once
+#include <QAbstractItemModel>
+#include <libbndl/bundle.hpp>
+#include <optional>
+#include <vector>
+
+using namespace libbndl;
+
+// Resources grouped by type, read straight from the bundle's index. Rows only exist as the view asks for
+// them, so bundles with hundreds of thousands of resources open as fast as small ones.
+class ResourceModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+public:
+	enum Column
+	{
+		NameColumn,
+		SizeColumn,
+		ColumnCount
+	};
+
+	explicit ResourceModel(const Bundle &bundle, QObject *parent = nullptr);
+
+	// Bracket every change to the bundle's resources, as the model reads the bundle's index in place.
+	void BeginReset();
+	void EndReset();
+	std::optional<uint32_t> GetResourceID(const QModelIndex &index) const;
+
+	QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+	QModelIndex parent(const QModelIndex &child) const override;
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+	void ReadIndex();
+
+	// Type rows have an internal ID of 0, resource rows that of their type row plus one.
+	static constexpr quintptr TypeRow = 0;
+
+	const Bundle &m_bundle;
+	std::vector<Bundle::ResourceType> m_types;
+	std::vector<Bundle::ResourceIDView> m_resourceIDs;
+};
@@ -0,0 +1,37 @@
+#include "common.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+bool ListFiles(const std::string &directory, std::vector<std::filesystem::path> &files)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+	for (auto it = fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied, error); !error && it != fs::recursive_directory_iterator(); it.increment(error))
+	{
+		if (it->is_regular_file(error))
+			files.push_back(it->path());
+	}
+	return !error;
+}
+
+unsigned ParallelForEach(size_t count, const std::function<void(size_t, unsigned)> &fn)
+{
+	const auto threadCount = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count)));
+
+	std::atomic<size_t> next = 0;
+	std::vector<std::thread> workers;
+	for (auto i = 0U; i < threadCount; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			for (auto index = next++; index < count; index = next++)
+				fn(index, i);
+		});
+	}
+	for (auto &worker : workers)
+		worker.join();
+
+	return threadCount;
+}
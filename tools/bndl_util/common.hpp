@@ -0,0 +1,12 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Every regular file below `directory`, or false if the directory can't be walked.
+bool ListFiles(const std::string &directory, std::vector<std::filesystem::path> &files);
+
+// Calls fn(index, worker) for every index in [0, count) on one thread per core.
+// Returns the number of workers used, which bounds the worker argument.
+unsigned ParallelForEach(size_t count, const std::function<void(size_t, unsigned)> &fn);
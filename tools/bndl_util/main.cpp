@@ -1,7 +1,11 @@
 #include <libbndl/bundle.hpp>
+#include <libbndl/namedictionary.hpp>
 #include <iostream>
 #include <iomanip>
 #include <cxxopts.hpp>
+#include "scan.hpp"
+#include "search.hpp"
+#include "verify.hpp"
 
 using namespace libbndl;
 
@@ -12,10 +16,66 @@ int main(int argc, char** argv)
 		("e,extract", "Extract the archive")
 		("p,pack", "Pack a folder structure to a bundle archive")
 		("f,file", "Name of the archive that should be extracted/generated", cxxopts::value<std::string>())
-		("s,search", "Search for an entry", cxxopts::value<std::string>())
-		("l,list", "List all entries");
+		("s,search", "Search the entry names of the archive, or of every archive in a directory", cxxopts::value<std::string>())
+		("m,match", "How --search matches names (prefix, substring or glob)", cxxopts::value<std::string>()->default_value("substring"))
+		("search-types", "Match --search against type names instead of names")
+		("l,list", "List all entries")
+		("d,diff", "List the entries added, removed or changed in a newer build of the archive, and write them as a patch to --output if given", cxxopts::value<std::string>())
+		("patch", "Apply a patch written by --diff to the archive and write the result to --output", cxxopts::value<std::string>())
+		("v,verify", "Check the integrity of the archive, or of every archive in a directory")
+		("c,convert", "Convert the archive to another platform (pc, x360 or ps3)", cxxopts::value<std::string>())
+		("o,output", "Name of the archive that should be written", cxxopts::value<std::string>())
+		("n,names", "Name dictionary used to name entries that have no debug info", cxxopts::value<std::string>())
+		("build-names", "Build a name dictionary from a list of names, one per line, and write it to --output", cxxopts::value<std::string>())
+		("scan", "Print statistics per resource type for every archive in a directory tree", cxxopts::value<std::string>())
+		("format", "Output format of --scan (json or csv)", cxxopts::value<std::string>()->default_value("json"));
 
 	auto parsedOptions = options.parse(argc, argv);
+	if (parsedOptions.count("scan") > 0)
+	{
+		const auto formatName = parsedOptions["format"].as<std::string>();
+		if (formatName != "json" && formatName != "csv")
+		{
+			std::cout << "Unknown format " << formatName << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		const auto directory = parsedOptions["scan"].as<std::string>();
+		if (!ScanBundles(directory, (formatName == "csv") ? ScanFormat::Csv : ScanFormat::Json, std::cout))
+		{
+			std::cerr << "Failed to scan " << directory << std::endl;
+			return EXIT_FAILURE;
+		}
+		return 0;
+	}
+
+	if (parsedOptions.count("build-names") > 0)
+	{
+		if (parsedOptions.count("output") == 0)
+		{
+			std::cout << "Please specify an output file." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		NameDictionary dictionary;
+		const auto listFile = parsedOptions["build-names"].as<std::string>();
+		if (!dictionary.AddFile(listFile) || !dictionary.Save(parsedOptions["output"].as<std::string>()))
+		{
+			std::cout << "Failed to build a name dictionary from " << listFile << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::cout << dictionary.GetSize() << " names" << std::endl;
+		return 0;
+	}
+
+	NameDictionary dictionary;
+	if (parsedOptions.count("names") > 0 && !dictionary.Load(parsedOptions["names"].as<std::string>()))
+	{
+		std::cout << "Failed to open " << parsedOptions["names"].as<std::string>() << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	if (parsedOptions.count("file") == 0)
 	{
 		std::cout << "Please specify an input file." << std::endl << options.help() << std::endl;
@@ -26,16 +86,47 @@ int main(int argc, char** argv)
 	bool pack = parsedOptions["pack"].as<bool>();
 	bool list = parsedOptions["list"].as<bool>();
 	std::string file = parsedOptions["file"].as<std::string>();
-	std::string search = parsedOptions["search"].as<std::string>();
-	bool bsearch = search.size() > 0;
+	bool bsearch = parsedOptions.count("search") > 0;
+	bool diff = parsedOptions.count("diff") > 0;
+	bool verify = parsedOptions["verify"].as<bool>();
+	bool convert = parsedOptions.count("convert") > 0;
+	bool applyPatch = parsedOptions.count("patch") > 0;
 	
-	if ((pack + extract + list + bsearch) != 1)
+	if ((pack + extract + list + bsearch + diff + verify + convert + applyPatch) != 1)
 	{
 		std::cout << "Please specify exactly one operation that should be executed." << std::endl
 		<< options.help() << std::endl;
 		return EXIT_FAILURE;
 	}
 
+	if (bsearch)
+	{
+		const auto matchName = parsedOptions["match"].as<std::string>();
+		NameIndex::MatchMode mode;
+		if (matchName == "prefix")
+			mode = NameIndex::Prefix;
+		else if (matchName == "substring")
+			mode = NameIndex::Substring;
+		else if (matchName == "glob")
+			mode = NameIndex::Glob;
+		else
+		{
+			std::cout << "Unknown match mode " << matchName << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		const auto field = parsedOptions["search-types"].as<bool>() ? NameIndex::TypeName : NameIndex::Name;
+		if (!SearchBundles(file, parsedOptions["search"].as<std::string>(), mode, field, std::cout))
+		{
+			std::cout << "Failed to open " << file << std::endl;
+			return EXIT_FAILURE;
+		}
+		return 0;
+	}
+
+	if (verify)
+		return VerifyBundles(file, std::cout) ? 0 : EXIT_FAILURE;
+
 	Bundle arch;
 	if (!pack)
 	{
@@ -50,23 +141,116 @@ int main(int argc, char** argv)
 			std::cout.fill('-');
 			std::cout << std::left << std::setw(70) << "NAME" << std::right << "FILE TYPE" << std::endl;
 			std::cout.fill(' ');
-			for (const auto &resourceID : arch.ListResourceIDs())
+			for (const auto &resource : arch.GetResources())
 			{
-				const auto debugInfo = arch.GetDebugInfo(resourceID);
-				const auto resourceType = *arch.GetResourceType(resourceID);
+				const auto *debugInfo = resource.debugInfo;
 				std::ostringstream name;
+				const auto dictionaryName = debugInfo ? std::nullopt : dictionary.Lookup(resource.resourceID);
 				if (debugInfo)
 					name << debugInfo->name;
+				else if (dictionaryName)
+					name << *dictionaryName;
 				else
-					name << std::hex << resourceID;
+					name << std::hex << resource.resourceID;
 				std::ostringstream typeName;
 				if (debugInfo)
 					typeName << debugInfo->typeName;
 				else
-					typeName << std::hex << resourceType;
+					typeName << std::hex << resource.resourceType;
 				std::cout << std::left << std::setw(70) << name.str() << std::right << typeName.str() << std::endl;
 			}
 		}
+		else if (diff)
+		{
+			const auto newerFile = parsedOptions["diff"].as<std::string>();
+			Bundle newer;
+			if (!newer.Load(newerFile))
+			{
+				std::cout << "Failed to open " << newerFile << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			const auto patch = arch.Diff(newer);
+			const auto printEntries = [&dictionary](const Bundle &bundle, const std::vector<uint32_t> &resourceIDs, char marker)
+			{
+				for (const auto resourceID : resourceIDs)
+				{
+					std::cout << marker << ' ' << std::hex << std::setw(8) << std::setfill('0') << resourceID << std::dec << std::setfill(' ');
+					const auto debugInfo = bundle.GetDebugInfo(resourceID);
+					const auto dictionaryName = debugInfo ? std::nullopt : dictionary.Lookup(resourceID);
+					if (debugInfo)
+						std::cout << ' ' << debugInfo->name;
+					else if (dictionaryName)
+						std::cout << ' ' << *dictionaryName;
+					std::cout << std::endl;
+				}
+			};
+			printEntries(arch, patch.removed, '-');
+			printEntries(newer, patch.added, '+');
+			printEntries(newer, patch.changed, '~');
+
+			if (parsedOptions.count("output") > 0)
+			{
+				const auto output = parsedOptions["output"].as<std::string>();
+				if (!Bundle::SavePatch(patch, output))
+				{
+					std::cout << "Failed to write " << output << std::endl;
+					return EXIT_FAILURE;
+				}
+			}
+		}
+		else if (applyPatch)
+		{
+			if (parsedOptions.count("output") == 0)
+			{
+				std::cout << "Please specify an output file." << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			const auto patchFile = parsedOptions["patch"].as<std::string>();
+			const auto patch = Bundle::LoadPatch(patchFile);
+			if (!patch)
+			{
+				std::cout << "Failed to open " << patchFile << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			const auto output = parsedOptions["output"].as<std::string>();
+			if (!arch.ApplyPatch(*patch) || !arch.Save(output))
+			{
+				std::cout << "Failed to apply " << patchFile << " to " << file << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (convert)
+		{
+			const auto platformName = parsedOptions["convert"].as<std::string>();
+			Bundle::Platform platform;
+			if (platformName == "pc")
+				platform = Bundle::PC;
+			else if (platformName == "x360")
+				platform = Bundle::Xbox360;
+			else if (platformName == "ps3")
+				platform = Bundle::PS3;
+			else
+			{
+				std::cout << "Unknown platform " << platformName << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			if (parsedOptions.count("output") == 0)
+			{
+				std::cout << "Please specify an output file." << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			const auto output = parsedOptions["output"].as<std::string>();
+			if (!arch.ConvertPlatform(platform) || !arch.Save(output))
+			{
+				std::cout << "Failed to convert " << file << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
 	}
 
 	return 0;
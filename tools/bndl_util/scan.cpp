@@ -0,0 +1,231 @@
+#include "scan.hpp"
+#include "common.hpp"
+#include <libbndl/bundle.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace libbndl;
+
+namespace
+{
+	struct BlockTotals
+	{
+		uint64_t uncompressed = 0;
+		uint64_t stored = 0;
+	};
+
+	struct TypeTotals
+	{
+		uint64_t resources = 0;
+		BlockTotals blocks[3];
+		uint64_t conflictingIDs = 0;
+	};
+
+	struct ResourceOwners
+	{
+		Bundle::ResourceType resourceType;
+		std::vector<size_t> bundles;
+	};
+
+	struct ScanTotals
+	{
+		uint64_t bundles = 0;
+		uint64_t skippedFiles = 0;
+		std::map<Bundle::ResourceType, TypeTotals> types;
+		std::unordered_map<uint32_t, ResourceOwners> owners;
+
+		void Add(const Bundle::BundleSummary &summary, size_t fileIndex)
+		{
+			bundles++;
+			const auto compressed = (summary.header.flags & Bundle::Compressed) != 0;
+			for (const auto &resource : summary.resources)
+			{
+				auto &type = types[resource.resourceType];
+				type.resources++;
+				for (auto i = 0; i < 3; i++)
+				{
+					type.blocks[i].uncompressed += resource.uncompressedSizes[i];
+					type.blocks[i].stored += compressed ? resource.compressedSizes[i] : resource.uncompressedSizes[i];
+				}
+
+				auto &owner = owners[resource.resourceID];
+				owner.resourceType = resource.resourceType;
+				owner.bundles.push_back(fileIndex);
+			}
+		}
+
+		void Merge(ScanTotals &other)
+		{
+			bundles += other.bundles;
+			skippedFiles += other.skippedFiles;
+			for (const auto &[resourceType, otherType] : other.types)
+			{
+				auto &type = types[resourceType];
+				type.resources += otherType.resources;
+				for (auto i = 0; i < 3; i++)
+				{
+					type.blocks[i].uncompressed += otherType.blocks[i].uncompressed;
+					type.blocks[i].stored += otherType.blocks[i].stored;
+				}
+			}
+			for (auto &[resourceID, otherOwner] : other.owners)
+			{
+				auto &owner = owners[resourceID];
+				owner.resourceType = otherOwner.resourceType;
+				owner.bundles.insert(owner.bundles.end(), otherOwner.bundles.begin(), otherOwner.bundles.end());
+			}
+		}
+	};
+
+	std::string Hex(uint32_t value)
+	{
+		std::ostringstream stream;
+		stream << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+		return stream.str();
+	}
+
+	std::string JsonString(const std::string &value)
+	{
+		std::ostringstream stream;
+		stream << '"';
+		for (const auto c : value)
+		{
+			if (c == '"' || c == '\\')
+				stream << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20)
+				stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+			else
+				stream << c;
+		}
+		stream << '"';
+		return stream.str();
+	}
+
+	double Ratio(uint64_t uncompressed, uint64_t stored)
+	{
+		return (stored == 0) ? 1.0 : static_cast<double>(uncompressed) / static_cast<double>(stored);
+	}
+
+	void WriteJson(const ScanTotals &totals, const std::vector<std::filesystem::path> &files, std::ostream &out)
+	{
+		out << "{\n";
+		out << "\t\"bundles\": " << totals.bundles << ",\n";
+		out << "\t\"skippedFiles\": " << totals.skippedFiles << ",\n";
+		out << "\t\"types\": [";
+		auto first = true;
+		for (const auto &[resourceType, type] : totals.types)
+		{
+			uint64_t uncompressed = 0;
+			uint64_t stored = 0;
+			out << (first ? "\n" : ",\n");
+			out << "\t\t{ \"type\": \"" << Hex(resourceType) << "\", \"resources\": " << type.resources << ", \"blocks\": [";
+			for (auto i = 0; i < 3; i++)
+			{
+				const auto &block = type.blocks[i];
+				uncompressed += block.uncompressed;
+				stored += block.stored;
+				out << ((i == 0) ? "" : ", ") << "{ \"uncompressed\": " << block.uncompressed << ", \"stored\": " << block.stored << " }";
+			}
+			out << "], \"ratio\": " << Ratio(uncompressed, stored) << ", \"conflictingIDs\": " << type.conflictingIDs << " }";
+			first = false;
+		}
+		out << "\n\t],\n";
+
+		out << "\t\"conflicts\": [";
+		first = true;
+		std::map<uint32_t, const ResourceOwners *> conflicts;
+		for (const auto &[resourceID, owner] : totals.owners)
+		{
+			if (owner.bundles.size() > 1)
+				conflicts.emplace(resourceID, &owner);
+		}
+		for (const auto &[resourceID, owner] : conflicts)
+		{
+			out << (first ? "\n" : ",\n");
+			out << "\t\t{ \"id\": \"" << Hex(resourceID) << "\", \"type\": \"" << Hex(owner->resourceType) << "\", \"bundles\": [";
+			for (auto i = 0U; i < owner->bundles.size(); i++)
+				out << ((i == 0) ? "" : ", ") << JsonString(files[owner->bundles[i]].generic_u8string());
+			out << "] }";
+			first = false;
+		}
+		out << "\n\t]\n";
+		out << "}" << std::endl;
+	}
+
+	void WriteCsv(const ScanTotals &totals, std::ostream &out)
+	{
+		out << "type,resources";
+		for (auto i = 0; i < 3; i++)
+			out << ",block" << i << "_uncompressed,block" << i << "_stored";
+		out << ",ratio,conflicting_ids\n";
+
+		for (const auto &[resourceType, type] : totals.types)
+		{
+			uint64_t uncompressed = 0;
+			uint64_t stored = 0;
+			out << Hex(resourceType) << ',' << type.resources;
+			for (const auto &block : type.blocks)
+			{
+				uncompressed += block.uncompressed;
+				stored += block.stored;
+				out << ',' << block.uncompressed << ',' << block.stored;
+			}
+			out << ',' << Ratio(uncompressed, stored) << ',' << type.conflictingIDs << '\n';
+		}
+		out.flush();
+	}
+}
+
+bool ScanBundles(const std::string &directory, ScanFormat format, std::ostream &out)
+{
+	std::vector<std::filesystem::path> files;
+	if (!ListFiles(directory, files))
+		return false;
+
+	// Every worker keeps its own totals, which are merged once all files are done.
+	std::vector<ScanTotals> workerTotals(std::max(1U, std::thread::hardware_concurrency()));
+	const auto workerCount = ParallelForEach(files.size(), [&](size_t fileIndex, unsigned worker)
+	{
+		std::optional<Bundle::BundleSummary> summary;
+		try
+		{
+			summary = Bundle::Summarize(files[fileIndex].string());
+		}
+		catch (const std::exception &)
+		{
+			// damaged bundle, skipped below
+		}
+
+		if (summary)
+			workerTotals[worker].Add(*summary, fileIndex);
+		else
+			workerTotals[worker].skippedFiles++;
+	});
+
+	ScanTotals totals;
+	for (auto i = 0U; i < workerCount; i++)
+		totals.Merge(workerTotals[i]);
+
+	for (auto &[resourceID, owner] : totals.owners)
+	{
+		if (owner.bundles.size() > 1)
+		{
+			std::sort(owner.bundles.begin(), owner.bundles.end());
+			totals.types[owner.resourceType].conflictingIDs++;
+		}
+	}
+
+	if (format == ScanFormat::Csv)
+		WriteCsv(totals, out);
+	else
+		WriteJson(totals, files, out);
+
+	return true;
+}
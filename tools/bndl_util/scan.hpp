@@ -0,0 +1,13 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+enum class ScanFormat
+{
+	Json,
+	Csv
+};
+
+// Reads the entry tables of every bundle below `directory` on all cores and writes totals per resource
+// type, plus resource IDs stored in more than one bundle. No resource data is read.
+bool ScanBundles(const std::string &directory, ScanFormat format, std::ostream &out);
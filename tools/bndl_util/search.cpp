@@ -0,0 +1,52 @@
+#include "search.hpp"
+#include "common.hpp"
+#include <libbndl/bundle.hpp>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+using namespace libbndl;
+
+bool SearchBundles(const std::string &path, const std::string &pattern, NameIndex::MatchMode mode, NameIndex::Field field, std::ostream &out)
+{
+	const auto isDirectory = std::filesystem::is_directory(path);
+
+	std::vector<std::filesystem::path> files;
+	if (!isDirectory)
+		files.emplace_back(path);
+	else if (!ListFiles(path, files))
+		return false;
+
+	NameIndex index;
+	std::vector<size_t> bundleFiles(files.size());
+	ParallelForEach(files.size(), [&](size_t fileIndex, unsigned)
+	{
+		// Only the header and the resource string table are read, not the resources.
+		std::optional<std::map<uint32_t, Bundle::EntryDebugInfo>> debugInfo;
+		try
+		{
+			debugInfo = Bundle::ReadDebugInfo(files[fileIndex].string());
+		}
+		catch (const std::exception &)
+		{
+			return; // damaged bundle
+		}
+
+		if (debugInfo)
+			bundleFiles[index.AddDebugInfo(*debugInfo)] = fileIndex;
+	});
+
+	if (!isDirectory && index.GetSize() == 0 && !Bundle::Probe(path))
+		return false;
+
+	for (const auto &match : index.Search(pattern, mode, field))
+	{
+		if (isDirectory)
+			out << files[bundleFiles[match.bundle]].generic_u8string() << ": ";
+		out << std::hex << std::setw(8) << std::setfill('0') << match.resourceID << std::dec << std::setfill(' ')
+			<< ' ' << match.name << " (" << match.typeName << ')' << std::endl;
+	}
+
+	return true;
+}
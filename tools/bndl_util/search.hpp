@@ -0,0 +1,7 @@
+#pragma once
+#include <libbndl/nameindex.hpp>
+#include <ostream>
+#include <string>
+
+// Searches the resource names of a bundle, or of every bundle below a directory, loading them on all cores.
+bool SearchBundles(const std::string &path, const std::string &pattern, libbndl::NameIndex::MatchMode mode, libbndl::NameIndex::Field field, std::ostream &out);
@@ -0,0 +1,73 @@
+#include "verify.hpp"
+#include "common.hpp"
+#include <libbndl/bundle.hpp>
+#include <iomanip>
+#include <vector>
+
+using namespace libbndl;
+
+namespace
+{
+	void WriteIssues(const std::vector<Bundle::VerifyIssue> &issues, std::ostream &out)
+	{
+		for (const auto &issue : issues)
+		{
+			if (issue.resourceID != 0)
+				out << std::hex << std::setw(8) << std::setfill('0') << issue.resourceID << std::dec << std::setfill(' ') << ": ";
+			out << issue.message << std::endl;
+		}
+	}
+}
+
+bool VerifyBundles(const std::string &path, std::ostream &out)
+{
+	if (!std::filesystem::is_directory(path))
+	{
+		const auto issues = Bundle::Verify(path);
+		WriteIssues(issues, out);
+		if (!issues.empty())
+			return false;
+
+		out << path << " is OK" << std::endl;
+		return true;
+	}
+
+	std::vector<std::filesystem::path> files;
+	if (!ListFiles(path, files))
+	{
+		out << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	// Issues are kept per file and written in file order once every file is done.
+	std::vector<std::vector<Bundle::VerifyIssue>> fileIssues(files.size());
+	std::vector<char> isBundle(files.size());
+	ParallelForEach(files.size(), [&](size_t fileIndex, unsigned)
+	{
+		const auto name = files[fileIndex].string();
+		if (!Bundle::Probe(name))
+			return;
+
+		isBundle[fileIndex] = true;
+		fileIssues[fileIndex] = Bundle::Verify(name);
+	});
+
+	size_t bundles = 0;
+	size_t damaged = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!isBundle[i])
+			continue;
+
+		bundles++;
+		if (fileIssues[i].empty())
+			continue;
+
+		damaged++;
+		out << files[i].generic_u8string() << ':' << std::endl;
+		WriteIssues(fileIssues[i], out);
+	}
+
+	out << bundles << " bundles verified, " << damaged << " with issues" << std::endl;
+	return damaged == 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+// Verifies a bundle, or every bundle below a directory on all cores, and writes the issues found.
+// Files in a directory that are not bundles are skipped. False if anything failed to verify.
+bool VerifyBundles(const std::string &path, std::ostream &out);